@@ -3,24 +3,47 @@
 // ----------------------------------------------------------------------------
 // A self-contained quant library demonstrating:
 //   1. Yield curve bootstrapping (piecewise linear zero rates)
-//   2. Black-Scholes analytical pricing + Greeks
-//   3. Monte Carlo pricing with variance reduction (antithetic + control variate)
-//   4. Local volatility surface (Dupire-style interpolation)
-//   5. Portfolio-level VaR (delta-normal & historical simulation)
+//   2. Black-Scholes analytical pricing + Greeks; discrete Asians (geometric closed
+//      form, Turnbull-Wakeman moment matching)
+//   3. Monte Carlo pricing with variance reduction (antithetic, control variate,
+//      importance sampling)
+//   4. Local volatility surface (Dupire-style interpolation) and parallel SVI
+//      calibration (Levenberg-Marquardt, arbitrage checks)
+//   5. Portfolio-level VaR (delta-normal, multi-factor delta-gamma & historical simulation)
 //   6. CVA / xVA stub for counterparty credit risk
+//   7. Bermudan / American exercise via Longstaff-Schwartz least-squares MC
+//   8. Crank-Nicolson finite-difference pricer (non-uniform grid, Rannacher start)
+//   9. Correlated multi-asset MC for basket and rainbow payoffs
+//  10. Heston stochastic vol: QE Monte Carlo + Fourier vanilla pricer
+//  11. Multilevel Monte Carlo for path-dependent payoffs
+//  12. Shared-path portfolio MC (one simulation per underlying, many payoffs)
+//  13. Live tick ingestion (lock-free MPSC queue) with incremental repricing
+//  14. Sharded MC across processes (counter-based stream, exactly mergeable partials)
+//  15. Chebyshev proxy tables for fast approximate revaluation in scenario loops
+//  16. Copy-on-write market data with epoch-based hot swap for concurrent pricing
+//  17. Persistent memory-mapped path cube (common random numbers across runs)
 //
 // Build:  g++ -std=c++20 -O2 -o quant_engine quant_engine.cpp -lm -pthread
 // ============================================================================
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <complex>
+#include <concepts>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <format>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -32,10 +55,22 @@
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // ============================================================================
 // §0  Math utilities
 // ============================================================================
@@ -105,6 +140,317 @@ double brent(std::function<double(double)> f, double a, double b,
     return b;
 }
 
+// In-place Cholesky factorisation A = L·Lᵀ of a row-major n×n SPD matrix.
+// On return the lower triangle holds L and the strict upper triangle is zeroed.
+inline void cholesky(std::vector<double>& A, std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j) {
+        double d = A[j*n + j];
+        for (std::size_t k = 0; k < j; ++k) d -= A[j*n + k] * A[j*n + k];
+        if (d <= 0.0) throw std::runtime_error("cholesky: matrix not positive definite");
+        double ljj = std::sqrt(d);
+        A[j*n + j] = ljj;
+        for (std::size_t i = j + 1; i < n; ++i) {
+            double s = A[i*n + j];
+            for (std::size_t k = 0; k < j; ++k) s -= A[i*n + k] * A[j*n + k];
+            A[i*n + j] = s / ljj;
+        }
+        for (std::size_t k = j + 1; k < n; ++k) A[j*n + k] = 0.0;
+    }
+}
+
+// Solve L·Lᵀ x = b given the factor from cholesky(); b is overwritten with x.
+inline void cholesky_solve(const std::vector<double>& L, std::size_t n, std::vector<double>& b) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double s = b[i];
+        for (std::size_t k = 0; k < i; ++k) s -= L[i*n + k] * b[k];
+        b[i] = s / L[i*n + i];
+    }
+    for (std::size_t i = n; i-- > 0;) {
+        double s = b[i];
+        for (std::size_t k = i + 1; k < n; ++k) s -= L[k*n + i] * b[k];
+        b[i] = s / L[i*n + i];
+    }
+}
+
+
+// Tridiagonal matrix factored once by the Thomas algorithm. Pivots are stored
+// as reciprocals, so each solve is two division-free sweeps; the factor can be
+// reused for every time step of a constant-coefficient scheme.
+class Tridiagonal {
+public:
+    Tridiagonal() = default;
+    // lower[0] and upper[n-1] are ignored
+    Tridiagonal(const std::vector<double>& lower, const std::vector<double>& diag,
+                const std::vector<double>& upper)
+        : lower_(lower), upper_(diag.size()), inv_pivot_(diag.size())
+    {
+        const std::size_t n = diag.size();
+        if (n == 0) return;
+        inv_pivot_[0] = 1.0 / diag[0];
+        upper_[0] = upper[0] * inv_pivot_[0];
+        for (std::size_t i = 1; i < n; ++i) {
+            inv_pivot_[i] = 1.0 / (diag[i] - lower_[i] * upper_[i-1]);
+            upper_[i] = (i + 1 < n ? upper[i] : 0.0) * inv_pivot_[i];
+        }
+    }
+
+    // Solve in place: d is overwritten with x
+    void solve(std::span<double> d) const {
+        const std::size_t n = inv_pivot_.size();
+        d[0] *= inv_pivot_[0];
+        for (std::size_t i = 1; i < n; ++i)
+            d[i] = (d[i] - lower_[i] * d[i-1]) * inv_pivot_[i];
+        for (std::size_t i = n - 1; i-- > 0;)
+            d[i] -= upper_[i] * d[i+1];
+    }
+
+private:
+    std::vector<double> lower_, upper_, inv_pivot_;
+};
+
+// Neumaier-compensated running sum
+struct KahanSum {
+    double sum  = 0.0;
+    double comp = 0.0;
+
+    void add(double x) noexcept {
+        double t = sum + x;
+        if (std::fabs(sum) >= std::fabs(x)) comp += (sum - t) + x;
+        else                                 comp += (x - t) + sum;
+        sum = t;
+    }
+    [[nodiscard]] double value() const noexcept { return sum + comp; }
+};
+
+// IEEE binary16 conversions (round to nearest even), for compact storage
+inline uint16_t float_to_half(float f) noexcept {
+    const uint32_t x = std::bit_cast<uint32_t>(f);
+    const uint32_t sign = (x >> 16) & 0x8000, mant = x & 0x7fffff;
+    const int32_t exp = static_cast<int32_t>((x >> 23) & 0xff) - 127 + 15;
+    if (((x >> 23) & 0xff) == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 : 0));
+    if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+    uint32_t h, rem, half;
+    if (exp <= 0) {                                 // half subnormal
+        if (exp < -10) return static_cast<uint16_t>(sign);
+        const uint32_t m = mant | 0x800000, shift = static_cast<uint32_t>(14 - exp);
+        h = m >> shift;
+        rem = m & ((1u << shift) - 1);
+        half = 1u << (shift - 1);
+    } else {
+        h = (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+        rem = mant & 0x1fff;
+        half = 0x1000;
+    }
+    if (rem > half || (rem == half && (h & 1))) ++h;   // a carry into the exponent is correct
+    return static_cast<uint16_t>(sign | h);
+}
+
+inline float half_to_float(uint16_t h) noexcept {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16, exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+    if (exp == 0) {
+        float f = std::ldexp(static_cast<float>(mant), -24);
+        return sign ? -f : f;
+    }
+    if (exp == 31) return std::bit_cast<float>(sign | 0x7f800000 | (mant << 13));
+    return std::bit_cast<float>(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+// Philox4x32-10 (Salmon et al., 2011): a counter-based generator. Each
+// output block is a pure function of (counter, key), so any draw can be
+// produced directly from its index, with no state to carry or skip ahead.
+class Philox4x32 {
+public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key     = std::array<uint32_t, 2>;
+
+    explicit Philox4x32(uint64_t seed) noexcept
+        : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    [[nodiscard]] Counter operator()(Counter c) const noexcept {
+        Key k = key_;
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = uint64_t{M0} * c[0], p1 = uint64_t{M1} * c[2];
+            c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1),
+                 static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0)};
+            k[0] += W0;
+            k[1] += W1;
+        }
+        return c;
+    }
+
+    // Two independent standard normals for (stream, index): Box-Muller on
+    // two 53-bit uniforms in (0, 1)
+    [[nodiscard]] std::pair<double, double> normals(uint64_t stream, uint64_t index) const noexcept {
+        Counter r = (*this)({static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                             static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)});
+        auto uniform = [](uint32_t hi, uint32_t lo) {
+            return ((((uint64_t{hi} << 32) | lo) >> 11) + 0.5) * 0x1p-53;
+        };
+        double rad = std::sqrt(-2.0 * std::log(uniform(r[0], r[1])));
+        double ang = 2.0 * PI * uniform(r[2], r[3]);
+        return {rad * std::cos(ang), rad * std::sin(ang)};
+    }
+
+private:
+    static constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    Key key_;
+};
+
+// Piecewise tensor-product Chebyshev interpolant of a smooth function on a
+// box in three variables. Each axis is split into equal pieces and every
+// patch of the resulting grid carries its own low-degree interpolant, built
+// from values at Chebyshev points of the first kind (one discrete cosine
+// transform per axis, in double): a lookup touches one patch only, and low
+// degrees on narrow pieces resolve sharp regions (an option near expiry)
+// that a single high-degree patch would need many more terms for.
+// Coefficients are kept in float, patch by patch, each stored [z][y][x] with
+// x padded to a multiple of four, so a whole table is a few kilobytes and
+// stays in L1. Evaluation contracts z, then y, as independent sweeps in
+// blocks of four, which the compiler turns into packed multiply-adds.
+class Chebyshev3D {
+public:
+    static constexpr std::size_t MAX_NODES = 16;
+
+    struct Axis {
+        double      lo, hi;
+        std::size_t n;            // nodes per piece; the degree is n - 1
+        std::size_t pieces = 1;
+
+        [[nodiscard]] std::size_t points() const noexcept { return n * pieces; }
+    };
+
+    // g-th interpolation point of an axis: node g % n of piece g / n
+    [[nodiscard]] static double node(const Axis& a, std::size_t g) noexcept {
+        double w = (a.hi - a.lo) / a.pieces, lo = a.lo + (g / a.n) * w;
+        double t = std::cos(PI * (g % a.n + 0.5) / a.n);
+        return lo + 0.5 * w * (1.0 + t);
+    }
+
+    // values[(gx·P_y + gy)·P_z + gz] = f(node(x, gx), node(y, gy), node(z, gz)),
+    // P the points() of each axis
+    Chebyshev3D(std::array<Axis, 3> axes, std::span<const double> values) : axes_(axes) {
+        for (auto& a : axes_)
+            if (a.n < 2 || a.n > MAX_NODES || a.pieces < 1 || !(a.hi > a.lo))
+                throw std::invalid_argument("Chebyshev3D: bad axis");
+        for (int d = 0; d < 3; ++d) scale_[d] = axes_[d].pieces / (axes_[d].hi - axes_[d].lo);
+        if (values.size() != size()) throw std::invalid_argument("Chebyshev3D: wrong number of values");
+        const std::size_t n[3] = {axes_[0].n, axes_[1].n, axes_[2].n};
+        const std::size_t P[3] = {axes_[0].points(), axes_[1].points(), axes_[2].points()};
+        const std::size_t stride[3] = {P[1] * P[2], P[2], 1};
+        std::vector<double> c(values.begin(), values.end()), line(MAX_NODES);
+        for (int d = 0; d < 3; ++d) {
+            const std::size_t m = n[d];
+            for (std::size_t base = 0; base < c.size(); ++base) {
+                if ((base / stride[d]) % m != 0) continue;      // visit each piece's line once
+                for (std::size_t k = 0; k < m; ++k) {
+                    double sum = 0;
+                    for (std::size_t j = 0; j < m; ++j)
+                        sum += c[base + j * stride[d]] * std::cos(PI * k * (j + 0.5) / m);
+                    line[k] = sum * (k ? 2.0 : 1.0) / m;
+                }
+                for (std::size_t k = 0; k < m; ++k) c[base + k * stride[d]] = line[k];
+            }
+        }
+        // Regroup by patch, [k][j][i] within a patch, rows padded with zeros.
+        // Since |T_k| ≤ 1, the coefficients on a patch's outer shell (highest
+        // degree along any axis) estimate its truncation error once the series
+        // decays geometrically; rounding to float adds half an ulp each.
+        row_ = (n[0] + 3) & ~std::size_t{3};
+        patch_ = n[2] * n[1] * row_;
+        const std::size_t n_patches = axes_[0].pieces * axes_[1].pieces * axes_[2].pieces;
+        coef_.assign(n_patches * patch_, 0.0f);
+        std::vector<double> tail(n_patches), rounding(n_patches);
+        for (std::size_t gx = 0; gx < P[0]; ++gx)
+            for (std::size_t gy = 0; gy < P[1]; ++gy)
+                for (std::size_t gz = 0; gz < P[2]; ++gz) {
+                    std::size_t i = gx % n[0], j = gy % n[1], k = gz % n[2];
+                    std::size_t patch = patch_index(gx / n[0], gy / n[1], gz / n[2]);
+                    double v = c[(gx * P[1] + gy) * P[2] + gz];
+                    coef_[patch * patch_ + (k * n[1] + j) * row_ + i] = static_cast<float>(v);
+                    if (i + 1 == n[0] || j + 1 == n[1] || k + 1 == n[2]) tail[patch] += std::fabs(v);
+                    rounding[patch] += std::fabs(v) * 0x1p-24;
+                }
+        for (std::size_t p = 0; p < n_patches; ++p)
+            error_ = std::max(error_, tail[p] + 4.0 * (n[0] + n[1] + n[2]) * rounding[p]);
+    }
+
+    [[nodiscard]] double operator()(double x, double y, double z) const noexcept {
+        std::array<float, MAX_NODES> tx{}, ty, tz;     // tx zero past n_x: contract reads whole rows
+        std::size_t px = basis(axes_[0], scale_[0], x, tx), py = basis(axes_[1], scale_[1], y, ty),
+                    pz = basis(axes_[2], scale_[2], z, tz);
+        const float* c = &coef_[patch_index(px, py, pz) * patch_];
+        switch (row_) {
+            case 4:  return contract<4>(c, tx, ty, tz);
+            case 8:  return contract<8>(c, tx, ty, tz);
+            case 12: return contract<12>(c, tx, ty, tz);
+            default: return contract<16>(c, tx, ty, tz);
+        }
+    }
+
+    [[nodiscard]] bool contains(double x, double y, double z) const noexcept {
+        return x >= axes_[0].lo && x <= axes_[0].hi && y >= axes_[1].lo && y <= axes_[1].hi
+            && z >= axes_[2].lo && z <= axes_[2].hi;
+    }
+
+    // Worst patch's truncation estimate plus a bound on float rounding
+    [[nodiscard]] double error_estimate() const noexcept { return error_; }
+
+    [[nodiscard]] const std::array<Axis, 3>& axes() const noexcept { return axes_; }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return axes_[0].points() * axes_[1].points() * axes_[2].points();
+    }
+    [[nodiscard]] std::size_t bytes() const noexcept { return coef_.size() * sizeof(float); }
+
+private:
+    [[nodiscard]] std::size_t patch_index(std::size_t px, std::size_t py, std::size_t pz) const noexcept {
+        return (px * axes_[1].pieces + py) * axes_[2].pieces + pz;
+    }
+
+    // Σ c[k][j][i]·tz[k]·ty[j]·tx[i] over one patch with rows of R floats: z
+    // then y folded into register-sized accumulators, x last. R is a compile
+    // time constant and the accumulators are locals, so the row loops are
+    // fixed-length and unaliased and vectorise; the padding of each row is
+    // zero in both c and tx.
+    template <std::size_t R>
+    [[nodiscard]] double contract(const float* c, const std::array<float, MAX_NODES>& tx,
+                                  const std::array<float, MAX_NODES>& ty,
+                                  const std::array<float, MAX_NODES>& tz) const noexcept {
+        const std::size_t ny = axes_[1].n, nz = axes_[2].n, plane = ny * R;
+        float xs[R] = {};
+        for (std::size_t j = 0; j < ny; ++j) {
+            float row[R];
+            for (std::size_t m = 0; m < R; ++m) row[m] = tz[0] * c[j * R + m];
+            for (std::size_t k = 1; k < nz; ++k)
+                for (std::size_t m = 0; m < R; ++m) row[m] += tz[k] * c[k * plane + j * R + m];
+            for (std::size_t m = 0; m < R; ++m) xs[m] += ty[j] * row[m];
+        }
+        double sum = 0;
+        for (std::size_t m = 0; m < R; ++m) sum += static_cast<double>(xs[m]) * tx[m];
+        return sum;
+    }
+
+    // Piece containing x (clamped to the box), with T_0..T_{n-1} at x mapped
+    // to [-1, 1] across that piece; scale is pieces / (hi - lo). The
+    // recurrence runs in float, the precision of the coefficients.
+    static std::size_t basis(const Axis& a, double scale, double x, std::array<float, MAX_NODES>& t) noexcept {
+        double u = std::clamp((x - a.lo) * scale, 0.0, static_cast<double>(a.pieces));
+        std::size_t p = std::min(static_cast<std::size_t>(u), a.pieces - 1);
+        const float v = static_cast<float>(2.0 * (u - p) - 1.0), two_v = 2.0f * v;
+        t[0] = 1.0f;
+        t[1] = v;
+        for (std::size_t k = 2; k < a.n; ++k) t[k] = two_v * t[k-1] - t[k-2];
+        return p;
+    }
+
+    std::array<Axis, 3> axes_;
+    std::array<double, 3> scale_{};   // pieces per unit along each axis
+    std::vector<float>  coef_;
+    std::size_t         row_ = 0;       // n_x padded to a multiple of four
+    std::size_t         patch_ = 0;     // floats per patch
+    double              error_ = 0;
+};
+
 } // namespace math
 
 // ============================================================================
@@ -132,22 +478,30 @@ public:
 
     // Bootstrap from par swap rates (simplified: annual fixed leg)
     static YieldCurve from_swap_rates(const std::vector<std::pair<double,double>>& swaps) {
-        std::vector<std::pair<double,double>> zeros;
-        std::vector<double> dfs;           // discount factors at integer years
+        YieldCurve c;
+        c.swaps_ = swaps;
+        std::sort(c.swaps_.begin(), c.swaps_.end());
+        c.dfs_.resize(c.swaps_.size());
+        c.pillars_.resize(c.swaps_.size());
+        c.bootstrap_from(0);
+        return c;
+    }
 
-        for (auto& [T, swap_rate] : swaps) {
-            int n = static_cast<int>(T);
-            double pv_fixed = 0.0;
-            for (int i = 0; i < n - 1 && i < static_cast<int>(dfs.size()); ++i)
-                pv_fixed += swap_rate * dfs[i];
-            double df_T = (1.0 - pv_fixed) / (1.0 + swap_rate);
-            dfs.push_back(df_T);
-            double zero = -std::log(df_T) / T;
-            zeros.emplace_back(T, zero);
-        }
-        return YieldCurve(zeros);
+    // Swap pillar k moved by dr and the curve rebootstrapped from pillar k on;
+    // the cached discount factors of the earlier pillars are reused as-is. A
+    // zero curve (no swap inputs) has zero rate k moved instead.
+    [[nodiscard]] YieldCurve bumped_pillar(std::size_t k, double dr) const {
+        if (k >= pillars_.size())
+            throw std::out_of_range("YieldCurve::bumped_pillar: no such pillar");
+        YieldCurve out = *this;
+        if (swaps_.empty()) { out.pillars_[k].second += dr; return out; }
+        out.swaps_[k].second += dr;
+        out.bootstrap_from(k);
+        return out;
     }
 
+    [[nodiscard]] const std::vector<std::pair<double,double>>& pillars() const noexcept { return pillars_; }
+
     // Piecewise-linear interpolation on zero rates
     [[nodiscard]] double zero_rate(double T) const {
         if (pillars_.empty()) return 0.0;
@@ -172,40 +526,517 @@ public:
     }
 
 private:
+    // Discount factors at integer years, pillars k.. recomputed from the
+    // swap inputs
+    void bootstrap_from(std::size_t k) {
+        for (std::size_t j = k; j < swaps_.size(); ++j) {
+            auto [T, swap_rate] = swaps_[j];
+            int n = static_cast<int>(T);
+            double pv_fixed = 0.0;
+            for (int i = 0; i < n - 1 && i < static_cast<int>(j); ++i)
+                pv_fixed += swap_rate * dfs_[i];
+            dfs_[j] = (1.0 - pv_fixed) / (1.0 + swap_rate);
+            pillars_[j] = {T, -std::log(dfs_[j]) / T};
+        }
+    }
+
     std::vector<std::pair<double,double>> pillars_;
+    std::vector<std::pair<double,double>> swaps_;   // bootstrap inputs, empty for a zero curve
+    std::vector<double> dfs_;
 };
 
 // ============================================================================
 // §3  Volatility Surface
 // ============================================================================
+// Raw SVI slice (Gatheral, 2004): total implied variance at one expiry as a
+// function of log-moneyness k = ln(K/F_T),
+//   w(k) = a + b·(ρ(k - m) + √((k - m)² + σ²))
+struct SVISlice {
+    double T, a, b, rho, m, sigma;
+
+    [[nodiscard]] double total_variance(double k) const noexcept {
+        double d = k - m;
+        return a + b * (rho * d + std::sqrt(d * d + sigma * sigma));
+    }
+
+    // Durrleman's condition: the slice implies a non-negative density (no
+    // butterfly arbitrage) at k iff g(k) ≥ 0
+    [[nodiscard]] double butterfly_density(double k) const noexcept {
+        double d = k - m, R = std::sqrt(d * d + sigma * sigma);
+        double w = total_variance(k);
+        double w1 = b * (rho + d / R), w2 = b * sigma * sigma / (R * R * R);
+        double u = 1.0 - k * w1 / (2.0 * w);
+        return u * u - 0.25 * w1 * w1 * (1.0 / w + 0.25) + 0.5 * w2;
+    }
+};
+
+// Copy-on-write: the nodes (or SVI slices) are immutable and shared between
+// copies, so copying a surface is a reference-count bump. Bumps go to a small
+// inline overlay of per-node vol shifts on top of the shared data; only when
+// the overlay is full are the shifts baked into a fresh copy of the data.
+// Scenario and bump generation therefore costs O(1) and allocates nothing.
 class VolSurface {
 public:
     struct Node { double T; double K; double vol; };
 
-    explicit VolSurface(std::vector<Node> nodes) : nodes_(std::move(nodes)) {}
+    explicit VolSurface(std::vector<Node> nodes)
+        : data_(std::make_shared<const Data>(Data{std::move(nodes), {}, 0, 0})) {}
 
     // Flat vol constructor
     explicit VolSurface(double flat_vol) : flat_vol_(flat_vol) {}
 
+    // SVI surface: one slice per expiry, total variance interpolated linearly
+    // in T at fixed log-moneyness (which preserves calendar monotonicity) and
+    // extrapolated at constant implied vol outside the slice range. The ATM
+    // point of each slice is exposed as a node, so risk bumps address slices.
+    VolSurface(std::vector<SVISlice> slices, double S0, double r, double q) {
+        if (slices.empty()) throw std::invalid_argument("VolSurface: no SVI slices");
+        std::sort(slices.begin(), slices.end(), [](auto& x, auto& y) { return x.T < y.T; });
+        Data d{{}, std::move(slices), S0, r - q};
+        for (auto& sl : d.svi)
+            d.nodes.push_back({sl.T, d.forward(sl.T), std::sqrt(sl.total_variance(0.0) / sl.T)});
+        data_ = std::make_shared<const Data>(std::move(d));
+    }
+
     [[nodiscard]] double implied_vol(double T, double K) const {
         if (flat_vol_) return *flat_vol_;
+        if (!data_->svi.empty()) return svi_vol(T, K);
 
         // Inverse-distance weighted interpolation on (T, K) space
         double wsum = 0, vsum = 0;
-        for (auto& n : nodes_) {
+        const auto& nodes = data_->nodes;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            const Node& n = nodes[i];
             double dt = (T - n.T), dk = (K - n.K) / K;  // normalise strike dim
             double d2 = dt*dt + dk*dk;
-            if (d2 < 1e-14) return n.vol;
+            if (d2 < 1e-14) return n.vol + shift(i);
             double w = 1.0 / d2;
             wsum += w;
-            vsum += w * n.vol;
+            vsum += w * (n.vol + shift(i));
         }
         return vsum / wsum;
     }
 
+    [[nodiscard]] bool is_flat() const noexcept { return flat_vol_.has_value(); }
+
+    // Unshifted nodes, shared by every copy; node_vol() includes bumps
+    [[nodiscard]] const std::vector<Node>& nodes() const noexcept {
+        static const std::vector<Node> none;
+        return data_ ? data_->nodes : none;
+    }
+    [[nodiscard]] double node_vol(std::size_t node) const {
+        return flat_vol_ ? *flat_vol_ : data_->nodes.at(node).vol + shift(node);
+    }
+
+    // Copy with one node's vol shifted by dv (the flat vol, for a flat surface;
+    // for SVI, the slice's level a moves so that its ATM vol shifts by dv)
+    [[nodiscard]] VolSurface bumped(std::size_t node, double dv) const {
+        VolSurface out = *this;
+        if (out.flat_vol_) { *out.flat_vol_ += dv; return out; }
+        if (node >= data_->nodes.size()) throw std::out_of_range("VolSurface::bumped: no such node");
+        for (std::size_t s = 0; s < out.n_shifts_; ++s)
+            if (out.shifts_[s].node == node) { out.shifts_[s].dv += dv; return out; }
+        if (out.n_shifts_ == MAX_SHIFTS) out.materialise();
+        out.shifts_[out.n_shifts_++] = {node, dv};
+        return out;
+    }
+
+private:
+    struct Data {
+        std::vector<Node>     nodes;
+        std::vector<SVISlice> svi;
+        double                S0, carry;    // SVI forwards
+
+        [[nodiscard]] double forward(double T) const noexcept { return S0 * std::exp(carry * T); }
+    };
+    struct Shift { std::size_t node; double dv; };
+    static constexpr std::size_t MAX_SHIFTS = 4;
+
+    [[nodiscard]] double shift(std::size_t node) const noexcept {
+        for (std::size_t s = 0; s < n_shifts_; ++s)
+            if (shifts_[s].node == node) return shifts_[s].dv;
+        return 0.0;
+    }
+
+    // Total variance of SVI slice i, with its overlay shift applied to a
+    [[nodiscard]] double slice_variance(std::size_t i, double k) const noexcept {
+        const SVISlice& sl = data_->svi[i];
+        double w = sl.total_variance(k), dv = shift(i);
+        if (dv != 0.0) {
+            double v = data_->nodes[i].vol;
+            w += ((v + dv) * (v + dv) - v * v) * sl.T;
+        }
+        return w;
+    }
+
+    // Bakes the overlay into a private copy of the data
+    void materialise() {
+        Data d = *data_;
+        for (std::size_t s = 0; s < n_shifts_; ++s) {
+            Node& n = d.nodes[shifts_[s].node];
+            double dv = shifts_[s].dv;
+            if (!d.svi.empty()) d.svi[shifts_[s].node].a += ((n.vol + dv) * (n.vol + dv) - n.vol * n.vol) * n.T;
+            n.vol += dv;
+        }
+        data_ = std::make_shared<const Data>(std::move(d));
+        n_shifts_ = 0;
+    }
+
+    [[nodiscard]] double svi_vol(double T, double K) const {
+        const auto& svi = data_->svi;
+        T = std::max(T, 1e-6);
+        const double k = std::log(K / data_->forward(T));
+        auto hi = static_cast<std::size_t>(std::lower_bound(svi.begin(), svi.end(), T,
+                      [](auto& sl, double t) { return sl.T < t; }) - svi.begin());
+        double w;
+        if (hi == 0)               w = slice_variance(0, k) * T / svi[0].T;
+        else if (hi == svi.size()) w = slice_variance(hi - 1, k) * T / svi[hi - 1].T;
+        else {
+            double a = (T - svi[hi - 1].T) / (svi[hi].T - svi[hi - 1].T);
+            w = (1 - a) * slice_variance(hi - 1, k) + a * slice_variance(hi, k);
+        }
+        return std::sqrt(std::max(w, 0.0) / T);
+    }
+
+    std::shared_ptr<const Data>        data_;     // null for a flat surface
+    std::optional<double>              flat_vol_;
+    std::array<Shift, MAX_SHIFTS>      shifts_{};
+    std::size_t                        n_shifts_ = 0;
+};
+
+// Dupire local volatility σ_loc(t, S), derived once from an implied surface and
+// stored on a dense uniform (t, log S) grid. With total implied variance
+// w(y, T) = σ_imp²·T at log-moneyness y = ln(K/F_T):
+//   σ_loc² = ∂w/∂T / [1 - y/w·∂w/∂y + ¼(-¼ - 1/w + y²/w²)(∂w/∂y)² + ½∂²w/∂y²]
+// w is first sampled on a (T, y) grid and smoothed with binomial passes,
+// because the inverse-distance surface is not smooth enough to differentiate
+// twice; calendar monotonicity of w is enforced before the derivatives.
+class LocalVolSurface {
+public:
+    // Vol as a function of log-spot at one fixed time: the time interpolation
+    // is done once when the slice is built, so a lookup is a single lerp.
+    class Slice {
+    public:
+        [[nodiscard]] double vol(double log_S) const noexcept {
+            double u = std::clamp((log_S - x0_) * inv_dx_, 0.0, static_cast<double>(vols_.size() - 1));
+            auto j = std::min(static_cast<std::size_t>(u), vols_.size() - 2);
+            double a = u - j;
+            return vols_[j] + a * (vols_[j+1] - vols_[j]);
+        }
+    private:
+        friend class LocalVolSurface;
+        std::vector<double> vols_;
+        double x0_ = 0, inv_dx_ = 0;
+    };
+
+    LocalVolSurface(const VolSurface& iv, double S0, double r, double q, double T_max,
+                    std::size_t n_t = 50, std::size_t n_x = 101, double n_std_devs = 4.0,
+                    std::size_t smoothing_passes = 16)
+        : n_t_(n_t), n_x_(n_x), vols_(n_t * n_x)
+    {
+        double atm = iv.implied_vol(T_max, S0);
+        double width = n_std_devs * atm * std::sqrt(T_max);
+        t0_ = 0.0;
+        x0_ = std::log(S0) - width;
+        dt_ = T_max / (n_t - 1);
+        dx_ = 2.0 * width / (n_x - 1);
+
+        // Total variance on T_k = (k+1)·dt, y_j = y0 + j·dx; the y range is
+        // padded so that x - ln F(t) stays inside it for every t ≤ T_max.
+        const double pad = std::fabs(r - q) * T_max + 2.0 * dx_;
+        const double y0 = -width - pad;
+        const std::size_t n_y = n_x + 2 * static_cast<std::size_t>(std::ceil(pad / dx_));
+        std::vector<double> w(n_t * n_y);
+        for (std::size_t k = 0; k < n_t; ++k) {
+            double T = (k + 1) * dt_;
+            double F = S0 * std::exp((r - q) * T);
+            for (std::size_t j = 0; j < n_y; ++j) {
+                double v = iv.implied_vol(T, F * std::exp(y0 + j * dx_));
+                w[k * n_y + j] = v * v * T;
+            }
+        }
+        std::vector<double> tmp(w.size());
+        for (std::size_t pass = 0; pass < smoothing_passes; ++pass) {
+            for (std::size_t k = 0; k < n_t; ++k)
+                for (std::size_t j = 0; j < n_y; ++j) {
+                    std::size_t jm = j ? j - 1 : j, jp = j + 1 < n_y ? j + 1 : j;
+                    tmp[k * n_y + j] = 0.25 * (w[k * n_y + jm] + 2.0 * w[k * n_y + j] + w[k * n_y + jp]);
+                }
+            for (std::size_t k = 0; k < n_t; ++k)
+                for (std::size_t j = 0; j < n_y; ++j) {
+                    // Smooth σ² (w/T) along T so the ratio, not w itself, is averaged
+                    std::size_t km = k ? k - 1 : k, kp = k + 1 < n_t ? k + 1 : k;
+                    double T = (k + 1) * dt_;
+                    w[k * n_y + j] = T * 0.25 * (tmp[km * n_y + j] / ((km + 1) * dt_)
+                                               + 2.0 * tmp[k * n_y + j] / T
+                                               + tmp[kp * n_y + j] / ((kp + 1) * dt_));
+                }
+        }
+        for (std::size_t k = 1; k < n_t; ++k)
+            for (std::size_t j = 0; j < n_y; ++j)
+                w[k * n_y + j] = std::max(w[k * n_y + j], w[(k - 1) * n_y + j] + 1e-6 * dt_);
+
+        constexpr double min_var = 0.01 * 0.01, max_var = 2.0 * 2.0;
+        std::vector<double> loc_var(n_y);
+        for (std::size_t i = 0; i < n_t; ++i) {
+            // Row i serves t_i = i·dt; t = 0 reuses the first sampled expiry
+            std::size_t k = i ? i - 1 : 0;
+            const double* wk = &w[k * n_y];
+            const double* wp = &w[(k + 1 < n_t ? k + 1 : k) * n_y];
+            const double* wm = &w[(k ? k - 1 : k) * n_y];
+            double dT = ((k + 1 < n_t ? k + 1 : k) - (k ? k - 1 : k)) * dt_;
+            for (std::size_t j = 0; j < n_y; ++j) {
+                std::size_t jm = j ? j - 1 : j, jp = j + 1 < n_y ? j + 1 : j;
+                double y    = y0 + j * dx_;
+                double w0   = wk[j];
+                double dwT  = (wp[j] - wm[j]) / dT;
+                double dwy  = (wk[jp] - wk[jm]) / ((jp - jm) * dx_);
+                double d2wy = (jp - jm == 2) ? (wk[jp] - 2.0 * w0 + wk[jm]) / (dx_ * dx_) : 0.0;
+                double denom = 1.0 - y / w0 * dwy
+                             + 0.25 * (-0.25 - 1.0 / w0 + y * y / (w0 * w0)) * dwy * dwy
+                             + 0.5 * d2wy;
+                double var = denom > 1e-8 ? dwT / denom : max_var;
+                loc_var[j] = std::clamp(var, min_var, max_var);
+            }
+            // Re-grid from log-moneyness onto log-spot at this time
+            double ln_F = std::log(S0) + (r - q) * (k + 1) * dt_;
+            for (std::size_t j = 0; j < n_x; ++j) {
+                double u = std::clamp((x0_ + j * dx_ - ln_F - y0) / dx_, 0.0, static_cast<double>(n_y - 1));
+                auto jj = std::min(static_cast<std::size_t>(u), n_y - 2);
+                double a = u - jj;
+                vols_[i * n_x + j] = std::sqrt((1 - a) * loc_var[jj] + a * loc_var[jj + 1]);
+            }
+        }
+    }
+
+    // Bilinear lookup
+    [[nodiscard]] double local_vol(double t, double S) const noexcept {
+        double u = std::clamp((t - t0_) / dt_, 0.0, static_cast<double>(n_t_ - 1));
+        auto i = std::min(static_cast<std::size_t>(u), n_t_ - 2);
+        double a = u - i;
+        double v = std::clamp((std::log(S) - x0_) / dx_, 0.0, static_cast<double>(n_x_ - 1));
+        auto j = std::min(static_cast<std::size_t>(v), n_x_ - 2);
+        double b = v - j;
+        const double* r0 = &vols_[i * n_x_];
+        const double* r1 = r0 + n_x_;
+        return (1 - a) * ((1 - b) * r0[j] + b * r0[j+1]) + a * ((1 - b) * r1[j] + b * r1[j+1]);
+    }
+
+    [[nodiscard]] Slice slice(double t) const {
+        double u = std::clamp((t - t0_) / dt_, 0.0, static_cast<double>(n_t_ - 1));
+        auto i = std::min(static_cast<std::size_t>(u), n_t_ - 2);
+        double a = u - i;
+        Slice s;
+        s.vols_.resize(n_x_);
+        for (std::size_t j = 0; j < n_x_; ++j)
+            s.vols_[j] = (1 - a) * vols_[i * n_x_ + j] + a * vols_[(i + 1) * n_x_ + j];
+        s.x0_ = x0_;
+        s.inv_dx_ = 1.0 / dx_;
+        return s;
+    }
+
+private:
+    std::size_t n_t_, n_x_;
+    double t0_, x0_, dt_, dx_;
+    std::vector<double> vols_;     // [t][log S]
+};
+
+// ============================================================================
+// §3a  SVI calibration
+// ============================================================================
+template <typename F> void run_workers(unsigned n, bool pin, F&& fn);   // §5
+
+struct SVIFit {
+    SVISlice slice;
+    double   rmse_vol;          // root-mean-square implied-vol error over the quotes
+    int      iterations;
+    bool     butterfly_free;    // Durrleman g(k) ≥ 0 across the checked range
+    bool     calendar_free;     // w(k) ≥ previous slice's w(k); true for the first
+};
+
+struct SVICalibration {
+    std::vector<SVIFit> fits;   // ascending expiry
+    double elapsed_ms = 0;
+
+    [[nodiscard]] bool arbitrage_free() const noexcept {
+        return std::all_of(fits.begin(), fits.end(),
+                           [](auto& f) { return f.butterfly_free && f.calendar_free; });
+    }
+};
+
+// Fits one raw SVI slice per quoted expiry by Levenberg-Marquardt on total
+// variance residuals, with the analytic Jacobian
+//   ∂w/∂a = 1, ∂w/∂b = ρd + R, ∂w/∂ρ = b·d, ∂w/∂m = -b(ρ + d/R), ∂w/∂σ = b·σ/R
+// (d = k - m, R = √(d² + σ²)). Steps are projected onto b ≥ 0, |ρ| < 1, σ > 0
+// and a + bσ√(1-ρ²) ≥ 0 (non-negative variance). Expiries are independent
+// and are fitted in parallel; each fit starts from the previous calibration
+// of the same expiry when there is one, so recalibrating after a quote update
+// usually converges in a few iterations.
+class SVICalibrator {
+public:
+    SVICalibrator(double S0, double r, double q, unsigned n_threads = 4)
+        : S0_(S0), r_(r), q_(q), n_threads_(std::max(1u, n_threads)) {}
+
+    // Quotes are (T, K, implied vol); a slice is fitted for every distinct T
+    // with at least five strikes
+    SVICalibration calibrate(std::span<const VolSurface::Node> quotes) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<VolSurface::Node> sorted(quotes.begin(), quotes.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](auto& x, auto& y) { return x.T != y.T ? x.T < y.T : x.K < y.K; });
+        std::vector<std::span<const VolSurface::Node>> groups;
+        for (std::size_t i = 0, j; i < sorted.size(); i = j) {
+            for (j = i; j < sorted.size() && sorted[j].T == sorted[i].T; ++j) {}
+            if (j - i >= 5) groups.emplace_back(sorted.data() + i, j - i);
+        }
+        if (groups.empty()) throw std::invalid_argument("SVICalibrator: no expiry with five quotes");
+
+        SVICalibration out;
+        out.fits.resize(groups.size());
+        const unsigned n = std::min<unsigned>(n_threads_, groups.size());
+        run_workers(n, false, [&](unsigned tid) {
+            Scratch scratch;
+            for (std::size_t i = tid; i < groups.size(); i += n)
+                out.fits[i] = fit(groups[i], scratch);
+        });
+
+        for (std::size_t i = 0; i < out.fits.size(); ++i) {
+            auto ks = check_range(groups[i]);
+            auto& f = out.fits[i];
+            f.butterfly_free = std::all_of(ks.begin(), ks.end(),
+                                           [&](double k) { return f.slice.butterfly_density(k) >= -1e-10; });
+            f.calendar_free = i == 0 || std::all_of(ks.begin(), ks.end(), [&](double k) {
+                return f.slice.total_variance(k) >= out.fits[i-1].slice.total_variance(k) - 1e-10;
+            });
+        }
+        previous_.clear();
+        for (auto& f : out.fits) previous_.push_back(f.slice);
+        out.elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count();
+        return out;
+    }
+
+    [[nodiscard]] VolSurface surface(const SVICalibration& cal) const {
+        std::vector<SVISlice> slices;
+        for (auto& f : cal.fits) slices.push_back(f.slice);
+        return VolSurface(std::move(slices), S0_, r_, q_);
+    }
+
 private:
-    std::vector<Node> nodes_;
-    std::optional<double> flat_vol_;
+    static constexpr int    MAX_ITER = 200;
+    static constexpr double TOL      = 1e-10;
+
+    struct Scratch { std::vector<double> k, w, res; };
+
+    // Log-moneyness grid for the arbitrage checks: the quoted range, widened
+    [[nodiscard]] std::vector<double> check_range(std::span<const VolSurface::Node> q) const {
+        double F = S0_ * std::exp((r_ - q_) * q.front().T);
+        double lo = std::log(q.front().K / F), hi = std::log(q.back().K / F);
+        double pad = 0.5 * (hi - lo);
+        std::vector<double> ks(65);
+        for (std::size_t i = 0; i < ks.size(); ++i)
+            ks[i] = lo - pad + (hi - lo + 2 * pad) * i / (ks.size() - 1);
+        return ks;
+    }
+
+    static void project(std::array<double, 5>& p) {
+        auto& [a, b, rho, m, sigma] = p;
+        b = std::max(b, 0.0);
+        rho = std::clamp(rho, -0.999, 0.999);
+        sigma = std::max(sigma, 1e-4);
+        a = std::max(a, -b * sigma * std::sqrt(1 - rho * rho));
+    }
+
+    static double residuals(const std::array<double, 5>& p, Scratch& s) {
+        SVISlice sl{0, p[0], p[1], p[2], p[3], p[4]};
+        double cost = 0;
+        for (std::size_t i = 0; i < s.k.size(); ++i) {
+            s.res[i] = sl.total_variance(s.k[i]) - s.w[i];
+            cost += s.res[i] * s.res[i];
+        }
+        return cost;
+    }
+
+    [[nodiscard]] SVIFit fit(std::span<const VolSurface::Node> q, Scratch& s) const {
+        const double T = q.front().T;
+        const double F = S0_ * std::exp((r_ - q_) * T);
+        const std::size_t n = q.size();
+        s.k.resize(n); s.w.resize(n); s.res.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            s.k[i] = std::log(q[i].K / F);
+            s.w[i] = q[i].vol * q[i].vol * T;
+        }
+
+        std::array<double, 5> p;
+        auto warm = std::find_if(previous_.begin(), previous_.end(), [&](auto& sl) { return sl.T == T; });
+        if (warm != previous_.end()) {
+            p = {warm->a, warm->b, warm->rho, warm->m, warm->sigma};
+        } else {
+            auto lo = std::min_element(s.w.begin(), s.w.end());
+            double slope = (s.w.back() - s.w.front()) / (s.k.back() - s.k.front());
+            p = {0.5 * *lo, 0.1, std::clamp(slope / 0.1, -0.5, 0.5), s.k[lo - s.w.begin()], 0.1};
+        }
+        project(p);
+
+        double cost = residuals(p, s), lambda = 1e-3;
+        std::vector<double> JtJ(25), Jtr(5), A(25), delta(5);
+        int iter = 0;
+        for (; iter < MAX_ITER; ++iter) {
+            // Normal equations JᵀJ·δ = -Jᵀr
+            std::fill(JtJ.begin(), JtJ.end(), 0.0);
+            std::fill(Jtr.begin(), Jtr.end(), 0.0);
+            const auto [a, b, rho, m, sigma] = p;
+            for (std::size_t i = 0; i < n; ++i) {
+                double d = s.k[i] - m, R = std::sqrt(d * d + sigma * sigma);
+                const double J[5] = {1.0, rho * d + R, b * d, -b * (rho + d / R), b * sigma / R};
+                for (int r = 0; r < 5; ++r) {
+                    Jtr[r] += J[r] * s.res[i];
+                    for (int c = 0; c <= r; ++c) JtJ[r * 5 + c] += J[r] * J[c];
+                }
+            }
+            for (int r = 0; r < 5; ++r)
+                for (int c = r + 1; c < 5; ++c) JtJ[r * 5 + c] = JtJ[c * 5 + r];
+
+            bool improved = false;
+            while (lambda < 1e12) {
+                A = JtJ;
+                for (int r = 0; r < 5; ++r) {
+                    A[r * 5 + r] += lambda * (JtJ[r * 5 + r] + 1e-12);
+                    delta[r] = -Jtr[r];
+                }
+                try {
+                    math::cholesky(A, 5);
+                    math::cholesky_solve(A, 5, delta);
+                } catch (const std::runtime_error&) { lambda *= 10; continue; }
+                std::array<double, 5> trial;
+                for (int r = 0; r < 5; ++r) trial[r] = p[r] + delta[r];
+                project(trial);
+                double trial_cost = residuals(trial, s);
+                if (trial_cost < cost) {
+                    improved = cost - trial_cost > TOL * (cost + TOL);
+                    p = trial;
+                    cost = trial_cost;
+                    lambda = std::max(lambda / 3, 1e-12);
+                    break;
+                }
+                lambda *= 4;
+            }
+            if (!improved) break;        // s.res already holds the accepted residuals
+        }
+
+        SVIFit f{{T, p[0], p[1], p[2], p[3], p[4]}, 0, iter, true, true};
+        double err2 = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            double e = std::sqrt(std::max(f.slice.total_variance(s.k[i]), 0.0) / T) - q[i].vol;
+            err2 += e * e;
+        }
+        f.rmse_vol = std::sqrt(err2 / n);
+        return f;
+    }
+
+    double S0_, r_, q_;
+    unsigned n_threads_;
+    std::vector<SVISlice> previous_;
 };
 
 // ============================================================================
@@ -234,206 +1065,3817 @@ BSResult black_scholes(OptionType type, double S, double K, double T,
     double df   = std::exp(-r * T);
     double dfq  = std::exp(-q * T);
 
-    BSResult res{};
-    if (type == OptionType::Call) {
-        res.price = S * dfq * Nd1 - K * df * Nd2;
-        res.delta = dfq * Nd1;
-        res.rho   = K * T * df * Nd2 / 100.0;
-    } else {
-        double Nmd1 = math::norm_cdf(-d1);
-        double Nmd2 = math::norm_cdf(-d2);
-        res.price = K * df * Nmd2 - S * dfq * Nmd1;
-        res.delta = -dfq * Nmd1;
-        res.rho   = -K * T * df * Nmd2 / 100.0;
+    BSResult res{};
+    if (type == OptionType::Call) {
+        res.price = S * dfq * Nd1 - K * df * Nd2;
+        res.delta = dfq * Nd1;
+        res.rho   = K * T * df * Nd2 / 100.0;
+    } else {
+        double Nmd1 = math::norm_cdf(-d1);
+        double Nmd2 = math::norm_cdf(-d2);
+        res.price = K * df * Nmd2 - S * dfq * Nmd1;
+        res.delta = -dfq * Nmd1;
+        res.rho   = -K * T * df * Nmd2 / 100.0;
+    }
+    res.gamma = dfq * nd1 / (S * sigma * sqrt_T);
+    res.vega  = S * dfq * nd1 * sqrt_T / 100.0;
+    res.theta = (-(S * dfq * nd1 * sigma) / (2.0 * sqrt_T)
+                 - r * K * df * (type == OptionType::Call ? Nd2 : -math::norm_cdf(-d2))
+                 + q * S * dfq * (type == OptionType::Call ? Nd1 : -math::norm_cdf(-d1))) / 365.0;
+    return res;
+}
+
+// Implied vol via Brent on BS price
+double implied_vol(OptionType type, double mkt_price, double S, double K,
+                   double T, double r, double q) {
+    auto f = [&](double sig) {
+        return black_scholes(type, S, K, T, r, q, sig).price - mkt_price;
+    };
+    return math::brent(f, 1e-4, 5.0);
+}
+
+// Black (1976) on a lognormal forward F with total variance v, discounted by df
+double black_forward(OptionType type, double F, double K, double v, double df) {
+    if (v <= 0.0) return df * std::max(type == OptionType::Call ? F - K : K - F, 0.0);
+    double sd = std::sqrt(v);
+    double d1 = (std::log(F / K) + 0.5 * v) / sd;
+    double d2 = d1 - sd;
+    return type == OptionType::Call ? df * (F * math::norm_cdf(d1) - K * math::norm_cdf(d2))
+                                    : df * (K * math::norm_cdf(-d2) - F * math::norm_cdf(-d1));
+}
+
+// ----------------------------------------------------------------------------
+// Discrete Asians: equally weighted average of the spot on increasing fixing
+// times 0 ≤ t_1 < ... < t_n ≤ T, paid at T, under GBM with flat r, q, σ.
+// Everything that depends only on the schedule, r and q is summed once here,
+// in O(n) using the sort order (min(t_i, t_j) = t_i for i < j):
+//   geometric:  ln G ~ N(ln S + (r-q-σ²/2)·t̄,  σ²·c),  c = (1/n²)ΣΣ min(t_i, t_j)
+//   arithmetic: M1 = S·Σ f_i,  M2 = S²·Σ g_i·e^{σ²t_i},
+//               f_i = e^{(r-q)t_i}/n,  g_i = f_i·(f_i + 2Σ_{j>i} f_j)
+// e^{σ²t_i} is built as a running product over the gaps between fixings, and
+// equal gaps share one factor, so a regular schedule costs one exp per vol.
+// The pricers take r and q from the schedule, so drift and discounting agree.
+// ----------------------------------------------------------------------------
+struct AsianSchedule {
+    double r, q;
+    std::vector<double> times;
+    std::vector<double> g;
+    std::vector<double> gaps;            // distinct t_i - t_{i-1} (t_0 = 0)
+    std::vector<uint32_t> gap_of;        // index into gaps per fixing
+    double t_mean = 0.0;
+    double t_cov = 0.0;
+    double f_sum = 0.0;
+
+    AsianSchedule(std::span<const double> fixings, double rate, double carry)
+        : r(rate), q(carry), times(fixings.begin(), fixings.end()) {
+        const std::size_t n = times.size();
+        if (n == 0) throw std::invalid_argument("AsianSchedule: no fixings");
+        for (std::size_t i = 0; i < n; ++i)
+            if (times[i] < 0.0 || (i && times[i] <= times[i-1]))
+                throw std::invalid_argument("AsianSchedule: fixings must be increasing and non-negative");
+        g.resize(n);
+        double tail = 0.0;   // Σ_{j>i} f_j
+        for (std::size_t i = n; i-- > 0;) {
+            double f = std::exp((r - q) * times[i]) / n;
+            g[i] = f * (f + 2.0 * tail);
+            tail += f;
+            t_mean += times[i] / n;
+            t_cov += times[i] * (2.0 * (n - 1 - i) + 1.0) / (double(n) * n);
+        }
+        f_sum = tail;
+
+        gap_of.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            double d = times[i] - (i ? times[i-1] : 0.0);
+            auto it = std::find_if(gaps.begin(), gaps.end(), [&](double x) { return std::abs(x - d) < 1e-12; });
+            gap_of[i] = static_cast<uint32_t>(it - gaps.begin());
+            if (it == gaps.end()) gaps.push_back(d);
+        }
+    }
+
+    // E[A²]/S² at volatility sigma
+    [[nodiscard]] double second_moment(double sigma) const {
+        std::vector<double> step(gaps.size());
+        for (std::size_t k = 0; k < gaps.size(); ++k) step[k] = std::exp(sigma * sigma * gaps[k]);
+        double m2 = 0.0, e = 1.0;
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            e *= step[gap_of[i]];
+            m2 += g[i] * e;
+        }
+        return m2;
+    }
+};
+
+// Geometric-average Asian: exact, the average being lognormal
+double asian_geometric(OptionType type, double S, double K, double T, double sigma,
+                       const AsianSchedule& sched) {
+    double v = sigma * sigma * sched.t_cov;
+    double F = S * std::exp((sched.r - sched.q - 0.5 * sigma * sigma) * sched.t_mean + 0.5 * v);
+    return black_forward(type, F, K, v, std::exp(-sched.r * T));
+}
+
+// Arithmetic-average Asian by Turnbull-Wakeman / Levy moment matching: the
+// average is replaced by the lognormal with the same first two moments.
+// Accurate to a few cents at equity vols and maturities; it degrades for
+// long-dated, high-vol averages where the true distribution is more skewed.
+double asian_arithmetic(OptionType type, double S, double K, double T, double sigma,
+                        const AsianSchedule& sched) {
+    double m1 = sched.f_sum;
+    double v = std::log(sched.second_moment(sigma) / (m1 * m1));
+    return black_forward(type, S * m1, K, v, std::exp(-sched.r * T));
+}
+
+double asian_geometric(OptionType type, double S, double K, double T, double r, double q, double sigma,
+                       std::span<const double> fixings) {
+    return asian_geometric(type, S, K, T, sigma, AsianSchedule(fixings, r, q));
+}
+
+double asian_arithmetic(OptionType type, double S, double K, double T, double r, double q, double sigma,
+                        std::span<const double> fixings) {
+    return asian_arithmetic(type, S, K, T, sigma, AsianSchedule(fixings, r, q));
+}
+
+// Batch forms over options sharing one schedule (with its r, q) and T: out[b] prices
+// (S[b], K[b], sigma[b]). The arithmetic moment sums run over blocks of
+// options, fixing-major with the block innermost, so the running products
+// are contiguous multiply-adds the compiler vectorises.
+void asian_geometric(OptionType type, std::span<const double> S, std::span<const double> K,
+                     std::span<const double> sigma, double T,
+                     const AsianSchedule& sched, std::span<double> out) {
+    for (std::size_t b = 0; b < out.size(); ++b)
+        out[b] = asian_geometric(type, S[b], K[b], T, sigma[b], sched);
+}
+
+void asian_arithmetic(OptionType type, std::span<const double> S, std::span<const double> K,
+                      std::span<const double> sigma, double T,
+                      const AsianSchedule& sched, std::span<double> out) {
+    constexpr std::size_t BLOCK = 64;
+    const std::size_t n_gaps = sched.gaps.size();
+    const double m1 = sched.f_sum, df = std::exp(-sched.r * T);
+    std::vector<double> step(n_gaps * BLOCK);
+    alignas(64) double e[BLOCK], m2[BLOCK];
+    for (std::size_t b0 = 0; b0 < out.size(); b0 += BLOCK) {
+        const std::size_t nb = std::min(BLOCK, out.size() - b0);
+        for (std::size_t k = 0; k < n_gaps; ++k)
+            for (std::size_t b = 0; b < nb; ++b)
+                step[k * BLOCK + b] = std::exp(sigma[b0 + b] * sigma[b0 + b] * sched.gaps[k]);
+        std::fill_n(e, BLOCK, 1.0);
+        std::fill_n(m2, BLOCK, 0.0);
+        for (std::size_t i = 0; i < sched.times.size(); ++i) {
+            const double* f = &step[sched.gap_of[i] * BLOCK];
+            const double g = sched.g[i];
+            for (std::size_t b = 0; b < BLOCK; ++b) {
+                e[b] *= f[b];
+                m2[b] += g * e[b];
+            }
+        }
+        for (std::size_t b = 0; b < nb; ++b)
+            out[b0 + b] = black_forward(type, S[b0 + b] * m1, K[b0 + b], std::log(m2[b] / (m1 * m1)), df);
+    }
+}
+
+// ============================================================================
+// §5  Monte Carlo Engine (multi-threaded, variance reduction)
+// ============================================================================
+class MCObserver;
+
+struct MCConfig {
+    uint64_t n_paths      = 500'000;
+    uint64_t n_steps      = 252;
+    bool     antithetic    = true;
+    bool     control_variate = true;   // use geometric-average as CV for Asian
+    double   drift_shift   = 0.0;      // importance sampling: mean of each step's normal
+    unsigned n_threads     = std::thread::hardware_concurrency();
+    bool     pin_threads   = false;    // pin worker t to CPU t (Linux; no-op elsewhere)
+    std::string checkpoint_path;       // empty = no checkpointing
+    uint64_t checkpoint_every = 1'000'000;   // paths per worker between checkpoints
+    MCObserver* observer   = nullptr;  // live progress reports, see MCTelemetry
+    double   report_interval_ms = 250;
+};
+
+struct MCResult {
+    double price;
+    double std_error;
+    double elapsed_ms;
+    bool   cancelled = false;          // stopped early by the observer
+};
+
+// Snapshot of a run in progress
+struct MCProgress {
+    uint64_t              paths_done;
+    uint64_t              paths_total;
+    double                mean;
+    double                std_error;
+    double                paths_per_sec;
+    double                elapsed_ms;
+    std::vector<uint64_t> per_thread;      // paths done by each worker
+};
+
+// Receives progress reports on the thread that called run(); returning false
+// cancels the run, which then returns the estimate from the paths done so far
+class MCObserver {
+public:
+    virtual ~MCObserver() = default;
+    virtual bool on_progress(const MCProgress& progress) = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Worker threads
+// ---------------------------------------------------------------------------
+inline constexpr std::size_t CACHE_LINE = 64;
+
+// One value per cache line, for per-thread slots written by different workers
+template <typename T>
+struct alignas(CACHE_LINE) CacheAligned {
+    T value{};
+};
+
+// Pins the calling thread to a single CPU
+inline void pin_to_cpu(unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// Runs fn(tid) for tid in [0, n) on n threads and joins them. With pin set,
+// worker t is pinned to CPU t (mod the CPU count) before fn starts, so the
+// buffers fn allocates and touches first are placed on that CPU's NUMA node:
+// workers should allocate their scratch space themselves, not receive it.
+// An exception thrown by fn is caught on its thread and the first one is
+// rethrown here once every worker has joined.
+template <typename F>
+void run_workers(unsigned n, bool pin, F&& fn) {
+    const unsigned n_cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n);
+    threads.reserve(n);
+    for (unsigned t = 0; t < n; ++t)
+        threads.emplace_back([&fn, &errors, pin, n_cpus, t] {
+            try {
+                if (pin) pin_to_cpu(t % n_cpus);
+                fn(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    for (auto& th : threads) th.join();
+    for (auto& e : errors)
+        if (e) std::rethrow_exception(e);
+}
+
+// Live progress for one run. Each worker owns a cache-line slot guarded by a
+// seqlock: publish() bumps the sequence to odd, stores (samples, sum, sum of
+// squares), and bumps it back to even; the reader retries until it sees the
+// same even sequence on both sides. Workers never wait, and publishing every
+// few dozen samples costs a handful of relaxed stores. The calling thread
+// polls the slots, reports to the observer and raises the stop flag if the
+// observer cancels.
+class MCTelemetry {
+public:
+    MCTelemetry(MCObserver& observer, unsigned n_workers, uint64_t samples_total,
+                uint64_t paths_per_sample)
+        : observer_(observer), slots_(n_workers), total_(samples_total),
+          paths_per_sample_(paths_per_sample), t0_(std::chrono::steady_clock::now()) {}
+
+    // Called by worker tid; false once the run has been cancelled
+    bool publish(unsigned tid, uint64_t samples, double sum, double sq) noexcept {
+        slots_[tid].write(samples, sum, sq);
+        return !stop_.load(std::memory_order_relaxed);
+    }
+
+    // The observer's answer is ignored on the final report: the run is over
+    void report(bool final = false) {
+        uint64_t n = 0;
+        double sum = 0, sq = 0;
+        MCProgress pr{};
+        pr.per_thread.resize(slots_.size());
+        for (std::size_t t = 0; t < slots_.size(); ++t) {
+            auto [n_t, sum_t, sq_t] = slots_[t].read();
+            n += n_t; sum += sum_t; sq += sq_t;
+            pr.per_thread[t] = n_t * paths_per_sample_;
+        }
+        pr.elapsed_ms    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0_).count();
+        pr.paths_done    = n * paths_per_sample_;
+        pr.paths_total   = total_ * paths_per_sample_;
+        pr.mean          = n ? sum / n : 0.0;
+        pr.std_error     = n > 1 ? std::sqrt(std::max(sq / n - pr.mean * pr.mean, 0.0) / n) : 0.0;
+        pr.paths_per_sec = pr.elapsed_ms > 0 ? pr.paths_done / (pr.elapsed_ms * 1e-3) : 0.0;
+        if (!observer_.on_progress(pr) && !final) stop_.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool cancelled() const noexcept { return stop_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t samples_total() const noexcept { return total_; }
+
+    // Runs the workers, reporting from the calling thread every interval
+    // until they have all finished, then once more
+    template <typename F>
+    void run(unsigned n, bool pin, double interval_ms, F&& fn) {
+        std::atomic<unsigned> done{0};
+        std::exception_ptr error;
+        std::thread pool([&] {
+            try {
+                run_workers(n, pin, [&](unsigned t) {
+                    // Counted even if fn throws, or the polling loop never ends
+                    struct Done {
+                        std::atomic<unsigned>& n;
+                        ~Done() { n.fetch_add(1, std::memory_order_release); }
+                    } mark{done};
+                    fn(t);
+                });
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+        const auto interval = std::chrono::duration<double, std::milli>(std::max(interval_ms, 1.0));
+        auto next = std::chrono::steady_clock::now() + interval;
+        while (done.load(std::memory_order_acquire) < n) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (std::chrono::steady_clock::now() >= next) {
+                report();
+                next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+            }
+        }
+        pool.join();
+        report(true);
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    class alignas(CACHE_LINE) Slot {
+    public:
+        void write(uint64_t n, double sum, double sq) noexcept {
+            uint64_t s = seq_.load(std::memory_order_relaxed);
+            seq_.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            n_.store(n, std::memory_order_relaxed);
+            sum_.store(sum, std::memory_order_relaxed);
+            sq_.store(sq, std::memory_order_relaxed);
+            seq_.store(s + 2, std::memory_order_release);
+        }
+        std::tuple<uint64_t, double, double> read() const noexcept {
+            for (;;) {
+                uint64_t s1 = seq_.load(std::memory_order_acquire);
+                if (s1 & 1) continue;
+                uint64_t n = n_.load(std::memory_order_relaxed);
+                double sum = sum_.load(std::memory_order_relaxed);
+                double sq  = sq_.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == s1) return {n, sum, sq};
+            }
+        }
+    private:
+        std::atomic<uint64_t> seq_{0};
+        std::atomic<uint64_t> n_{0};
+        std::atomic<double>   sum_{0.0};
+        std::atomic<double>   sq_{0.0};
+    };
+
+    MCObserver&       observer_;
+    std::vector<Slot> slots_;
+    uint64_t          total_, paths_per_sample_;
+    std::chrono::steady_clock::time_point t0_;
+    std::atomic<bool> stop_{false};
+};
+
+// Splits [0, n) into blocks of `block` indices dealt round-robin to n_threads
+// workers, calling fn(lo, hi, tid) once per block
+template <typename F>
+void parallel_blocks(std::size_t n, std::size_t block, unsigned n_threads, F&& fn) {
+    const std::size_t n_blocks = (n + block - 1) / block;
+    n_threads = std::max(1u, std::min<unsigned>(n_threads, static_cast<unsigned>(std::max<std::size_t>(n_blocks, 1))));
+    run_workers(n_threads, false, [&](unsigned tid) {
+        for (std::size_t b = tid; b < n_blocks; b += n_threads)
+            fn(b * block, std::min(n, (b + 1) * block), tid);
+    });
+}
+
+// Payoff function signature: (path of spot prices) -> payoff
+template <typename Real>
+using BasicPayoff = std::function<double(const std::vector<Real>&)>;
+using Payoff = BasicPayoff<double>;
+
+// Streaming payoffs see the path one spot at a time and keep O(1) state:
+// init() resets, observe(step, S) is called for step = 0..n_steps (step 0 is
+// the initial spot), finish() returns the undiscounted payoff.
+template <typename P>
+concept StreamingPayoff = std::copy_constructible<P> && requires(P p, const P cp, uint64_t step, double S) {
+    p.init();
+    p.observe(step, S);
+    { cp.finish() } -> std::convertible_to<double>;
+};
+
+// Building-block accumulators for streaming payoffs
+namespace acc {
+
+struct Terminal {
+    double spot = 0.0;
+    void reset() noexcept { spot = 0.0; }
+    void observe(uint64_t, double S) noexcept { spot = S; }
+};
+
+struct RunningAverage {
+    double   sum = 0.0;
+    uint64_t n   = 0;
+    void reset() noexcept { sum = 0.0; n = 0; }
+    void observe(uint64_t, double S) noexcept { sum += S; ++n; }
+    [[nodiscard]] double mean() const noexcept { return n ? sum / n : 0.0; }
+};
+
+struct RunningMax {
+    double max = -std::numeric_limits<double>::infinity();
+    void reset() noexcept { max = -std::numeric_limits<double>::infinity(); }
+    void observe(uint64_t, double S) noexcept { max = std::max(max, S); }
+};
+
+struct RunningMin {
+    double min = std::numeric_limits<double>::infinity();
+    void reset() noexcept { min = std::numeric_limits<double>::infinity(); }
+    void observe(uint64_t, double S) noexcept { min = std::min(min, S); }
+};
+
+struct BarrierHit {
+    double level;
+    bool   up;
+    bool   hit = false;
+    void reset() noexcept { hit = false; }
+    void observe(uint64_t, double S) noexcept { hit |= up ? S >= level : S <= level; }
+};
+
+} // namespace acc
+
+// A streaming payoff assembled from accumulators: every observation is fed to
+// each accumulator and finish() applies f to them, e.g.
+//   stream_payoff([K](const acc::RunningAverage& a) { return std::max(a.mean() - K, 0.0); },
+//                 acc::RunningAverage{});
+template <typename F, typename... Acc>
+class ComposedPayoff {
+public:
+    ComposedPayoff(F f, Acc... accs) : f_(std::move(f)), acc_(std::move(accs)...) {}
+
+    void init() noexcept { std::apply([](auto&... a) { (a.reset(), ...); }, acc_); }
+    void observe(uint64_t step, double S) noexcept {
+        std::apply([&](auto&... a) { (a.observe(step, S), ...); }, acc_);
+    }
+    [[nodiscard]] double finish() const { return std::apply(f_, acc_); }
+
+private:
+    F                  f_;
+    std::tuple<Acc...> acc_;
+};
+
+template <typename F, typename... Acc>
+ComposedPayoff<F, Acc...> stream_payoff(F f, Acc... accs) {
+    return ComposedPayoff<F, Acc...>(std::move(f), std::move(accs)...);
+}
+
+// Path payoffs: any callable on the stored path returning a value convertible
+// to double. Passing the concrete type (not std::function) lets the compiler
+// inline it into the simulation loop.
+template <typename P, typename Real>
+concept PathPayoff = std::invocable<const P&, const std::vector<Real>&> &&
+    std::convertible_to<std::invoke_result_t<const P&, const std::vector<Real>&>, double>;
+
+// Barrier payoff with option type, barrier direction and knock type fixed at
+// compile time: observe() is a branch-free compare-and-or and finish() carries
+// no runtime product flags.
+template <OptionType Type, bool Up, bool KnockIn>
+struct BarrierKernel {
+    double strike;
+    double barrier;
+    bool   hit  = false;
+    double last = 0.0;
+
+    void init() noexcept { hit = false; }
+    void observe(uint64_t, double S) noexcept {
+        if constexpr (Up) hit |= S >= barrier;
+        else              hit |= S <= barrier;
+        last = S;
+    }
+    [[nodiscard]] double finish() const noexcept {
+        double intrinsic = Type == OptionType::Call ? std::max(last - strike, 0.0)
+                                                    : std::max(strike - last, 0.0);
+        return hit == KnockIn ? intrinsic : 0.0;
+    }
+};
+
+// Calls f(std::true_type{}) or f(std::false_type{}), turning a runtime flag
+// into a compile-time one for the kernels above
+template <typename F>
+decltype(auto) dispatch_bool(bool flag, F&& f) {
+    return flag ? f(std::true_type{}) : f(std::false_type{});
+}
+
+// Binary checkpoint of a Monte Carlo run: a header (magic, version, a
+// fingerprint of the run's inputs) and, per worker, the paths done so far,
+// the compensated sums and the engine and normal-distribution state. Workers
+// are independent streams, so each one can be snapshotted on its own
+// schedule; resuming replays nothing and reproduces the uninterrupted run
+// exactly. The payoff is not part of the fingerprint: resume with the same one.
+class MCCheckpoint {
+public:
+    struct Worker {
+        uint64_t                 paths_done = 0;
+        math::KahanSum           sum, sq;
+        std::vector<uint64_t>    engine;      // mt19937_64 words + position
+        std::string              normal;      // normal_distribution state
+    };
+
+    MCCheckpoint(std::string path, uint64_t fingerprint, unsigned n_workers)
+        : path_(std::move(path)), fingerprint_(fingerprint), workers_(n_workers) {}
+
+    // Reads the file if it exists and was written by a run with the same
+    // fingerprint; otherwise every worker starts from scratch
+    bool load() {
+        std::ifstream in(path_, std::ios::binary);
+        if (!in) return false;
+        uint64_t magic = 0, version = 0, fp = 0, n = 0;
+        read(in, magic); read(in, version); read(in, fp); read(in, n);
+        if (!in || magic != MAGIC || version != VERSION || fp != fingerprint_ || n != workers_.size())
+            return false;
+        std::vector<Worker> ws(n);
+        for (auto& w : ws) {
+            uint64_t n_words = 0, n_chars = 0;
+            read(in, w.paths_done);
+            read(in, w.sum.sum); read(in, w.sum.comp);
+            read(in, w.sq.sum);  read(in, w.sq.comp);
+            read(in, n_words);
+            if (!in || n_words > MAX_WORDS) return false;
+            w.engine.resize(n_words);
+            in.read(reinterpret_cast<char*>(w.engine.data()), n_words * sizeof(uint64_t));
+            read(in, n_chars);
+            if (!in || n_chars > MAX_CHARS) return false;
+            w.normal.resize(n_chars);
+            in.read(w.normal.data(), n_chars);
+        }
+        if (!in) return false;
+        workers_ = std::move(ws);
+        return true;
+    }
+
+    // Snapshot of one worker, then the whole file rewritten via a temporary
+    // and a rename so a kill mid-write leaves the previous checkpoint intact
+    template <typename Engine, typename Dist>
+    void store(unsigned tid, uint64_t paths_done, const Engine& rng, const Dist& N,
+               const math::KahanSum& sum, const math::KahanSum& sq) {
+        Worker w{paths_done, sum, sq, {}, {}};
+        std::stringstream ss;
+        ss << rng;
+        for (uint64_t word; ss >> word;) w.engine.push_back(word);
+        std::ostringstream ns;
+        ns << N;
+        w.normal = ns.str();
+
+        std::lock_guard lock(mutex_);
+        workers_[tid] = std::move(w);
+        save();
+    }
+
+    // Writes the current state; open_checkpoint calls it before any worker
+    // starts, so an unwritable path fails on the calling thread
+    void save() const {
+        const std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            write(out, MAGIC); write(out, VERSION); write(out, fingerprint_);
+            write(out, static_cast<uint64_t>(workers_.size()));
+            for (auto& wk : workers_) {
+                write(out, wk.paths_done);
+                write(out, wk.sum.sum); write(out, wk.sum.comp);
+                write(out, wk.sq.sum);  write(out, wk.sq.comp);
+                write(out, static_cast<uint64_t>(wk.engine.size()));
+                out.write(reinterpret_cast<const char*>(wk.engine.data()), wk.engine.size() * sizeof(uint64_t));
+                write(out, static_cast<uint64_t>(wk.normal.size()));
+                out.write(wk.normal.data(), wk.normal.size());
+            }
+            if (!out) throw std::runtime_error("MCCheckpoint: cannot write " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path_.c_str()) != 0)
+            throw std::runtime_error("MCCheckpoint: cannot replace " + path_);
+    }
+
+    // Restores worker tid's state; returns the paths it had already done
+    template <typename Engine, typename Dist>
+    uint64_t restore(unsigned tid, Engine& rng, Dist& N, math::KahanSum& sum, math::KahanSum& sq) const {
+        const Worker& w = workers_[tid];
+        if (w.paths_done == 0) return 0;
+        std::stringstream ss;
+        for (uint64_t word : w.engine) ss << word << ' ';
+        ss >> rng;
+        std::istringstream ns(w.normal);
+        ns >> N;
+        sum = w.sum;
+        sq  = w.sq;
+        return w.paths_done;
+    }
+
+    // Called once the run has completed
+    void remove() const { std::remove(path_.c_str()); }
+
+    // FNV-1a over the raw bytes of the run's inputs
+    template <typename... Ts>
+    static uint64_t fingerprint(const Ts&... xs) {
+        uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](const auto& x) {
+            const auto* b = reinterpret_cast<const unsigned char*>(&x);
+            for (std::size_t i = 0; i < sizeof(x); ++i) { h ^= b[i]; h *= 1099511628211ull; }
+        };
+        (mix(xs), ...);
+        return h;
+    }
+
+private:
+    static constexpr uint64_t MAGIC     = 0x54504b43434d4551ull;   // "QEMCCKPT"
+    static constexpr uint64_t VERSION   = 1;
+    static constexpr uint64_t MAX_WORDS = 1 << 12;
+    static constexpr uint64_t MAX_CHARS = 1 << 12;
+
+    template <typename T> static void read(std::istream& in, T& x) {
+        in.read(reinterpret_cast<char*>(&x), sizeof(T));
+    }
+    template <typename T> static void write(std::ostream& out, const T& x) {
+        out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    std::string path_;
+    uint64_t fingerprint_;
+    std::vector<Worker> workers_;
+    std::mutex mutex_;
+};
+
+// Partial result of a sharded run. Samples are grouped into fixed chunks of
+// CHUNK consecutive sample indices; each chunk keeps its own sums, computed
+// in index order, and the final estimate Kahan-sums the chunks in chunk
+// order. Merged shards therefore reproduce a one-process run bit for bit,
+// however the range was split across processes or threads.
+struct MCPartial {
+    static constexpr uint64_t CHUNK = 4096;
+
+    struct Chunk {
+        uint64_t index;                  // global chunk number
+        uint64_t count;                  // samples in the chunk
+        double   sum, sq;
+        double   delta, gamma;           // zero unless greeks were requested
+    };
+
+    uint64_t           fingerprint = 0;
+    bool               greeks      = false;
+    uint64_t           total       = 0;  // samples in the whole job
+    std::vector<Chunk> chunks;           // sorted by index
+
+    // Adds another shard of the same job; overlapping shards are an error
+    void merge(const MCPartial& other) {
+        if (chunks.empty()) { fingerprint = other.fingerprint; greeks = other.greeks; total = other.total; }
+        else if (other.fingerprint != fingerprint || other.greeks != greeks || other.total != total)
+            throw std::invalid_argument("MCPartial::merge: shards of different jobs");
+        std::vector<Chunk> merged;
+        merged.reserve(chunks.size() + other.chunks.size());
+        std::merge(chunks.begin(), chunks.end(), other.chunks.begin(), other.chunks.end(),
+                   std::back_inserter(merged), [](auto& a, auto& b) { return a.index < b.index; });
+        for (std::size_t i = 1; i < merged.size(); ++i)
+            if (merged[i].index == merged[i-1].index)
+                throw std::invalid_argument("MCPartial::merge: overlapping shards");
+        chunks = std::move(merged);
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept {
+        uint64_t n = 0;
+        for (auto& c : chunks) n += c.count;
+        return n;
+    }
+
+    // True when the chunks cover samples [0, total) with no hole, i.e. every
+    // shard of the job has been merged
+    [[nodiscard]] bool complete() const noexcept {
+        if (total == 0 || chunks.size() != (total + CHUNK - 1) / CHUNK) return false;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+            if (chunks[i].index != i || chunks[i].count != std::min(CHUNK, total - i * CHUNK)) return false;
+        return true;
+    }
+
+    // The estimates need the complete job: a missing shard would still give a
+    // plausible mean, just not the single-process one
+    [[nodiscard]] MCResult result() const {
+        require_complete();
+        math::KahanSum sum, sq;
+        for (auto& c : chunks) { sum.add(c.sum); sq.add(c.sq); }
+        const double N = static_cast<double>(count());
+        double mean = sum.value() / N;
+        return {mean, std::sqrt(std::max(sq.value() / N - mean * mean, 0.0) / N), 0.0};
+    }
+    [[nodiscard]] double delta() const { return mean_of(&Chunk::delta); }
+    [[nodiscard]] double gamma() const { return mean_of(&Chunk::gamma); }
+
+    // File layout, every field a little-endian 64-bit word (doubles by their
+    // IEEE bits) so partials move between machines: magic, version,
+    // fingerprint, greeks, job total, chunk count, then six words per chunk
+    void save(const std::string& path) const {
+        std::vector<unsigned char> buf;
+        buf.reserve(HEADER_WORDS * 8 + chunks.size() * CHUNK_WORDS * 8);
+        for (uint64_t w : {MAGIC, VERSION, fingerprint, uint64_t{greeks}, total, uint64_t{chunks.size()}})
+            put(buf, w);
+        for (auto& c : chunks)
+            for (uint64_t w : {c.index, c.count, std::bit_cast<uint64_t>(c.sum), std::bit_cast<uint64_t>(c.sq),
+                               std::bit_cast<uint64_t>(c.delta), std::bit_cast<uint64_t>(c.gamma)})
+                put(buf, w);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        if (!out) throw std::runtime_error("MCPartial: cannot write " + path);
+    }
+
+    static MCPartial load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<unsigned char> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (buf.size() < HEADER_WORDS * 8 || get(buf, 0) != MAGIC)
+            throw std::runtime_error("MCPartial: not a partial result: " + path);
+        if (get(buf, 1) != VERSION) throw std::runtime_error("MCPartial: unsupported version in " + path);
+        const uint64_t n = get(buf, 5);
+        // Bounded by the file before the multiply, so a corrupt count cannot wrap
+        if (n > (buf.size() / 8 - HEADER_WORDS) / CHUNK_WORDS || buf.size() != (HEADER_WORDS + n * CHUNK_WORDS) * 8)
+            throw std::runtime_error("MCPartial: truncated " + path);
+        MCPartial p;
+        p.fingerprint = get(buf, 2);
+        p.greeks = get(buf, 3) != 0;
+        p.total = get(buf, 4);
+        p.chunks.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t w = HEADER_WORDS + i * CHUNK_WORDS;
+            p.chunks[i] = {get(buf, w), get(buf, w + 1),
+                           std::bit_cast<double>(get(buf, w + 2)), std::bit_cast<double>(get(buf, w + 3)),
+                           std::bit_cast<double>(get(buf, w + 4)), std::bit_cast<double>(get(buf, w + 5))};
+        }
+        return p;
+    }
+
+private:
+    static constexpr uint64_t MAGIC = 0x545241504d4551ull;   // "QEMPART"
+    static constexpr uint64_t VERSION = 3;
+    static constexpr std::size_t HEADER_WORDS = 6, CHUNK_WORDS = 6;
+
+    static void put(std::vector<unsigned char>& buf, uint64_t w) {
+        for (int b = 0; b < 8; ++b) buf.push_back(static_cast<unsigned char>(w >> (8 * b)));
+    }
+    static uint64_t get(const std::vector<unsigned char>& buf, std::size_t word) {
+        uint64_t w = 0;
+        for (int b = 0; b < 8; ++b) w |= uint64_t{buf[word * 8 + b]} << (8 * b);
+        return w;
+    }
+
+    void require_complete() const {
+        if (!complete())
+            throw std::runtime_error("MCPartial: incomplete job, " + std::to_string(count()) + " of " +
+                                     std::to_string(total) + " samples merged");
+    }
+
+    [[nodiscard]] double mean_of(double Chunk::* field) const {
+        require_complete();
+        math::KahanSum s;
+        for (auto& c : chunks) s.add(c.*field);
+        return s.value() / static_cast<double>(count());
+    }
+};
+
+// Persistent path cube: Brownian values at a set of observation dates for
+// n_paths paths, written once to a file and memory-mapped by every later run
+// and process that asks for the same cube. Each value is stored as
+// W(t_k)/√t_k, a standard normal, so half precision loses the same relative
+// accuracy at every date and nothing accumulates across dates. The draws
+// come from the Philox stream by (path, date), so a cube's contents depend
+// only on its dates, path count and seed. Runs that read one cube with
+// different spot, rate or vol use common random numbers, and bumped
+// revaluations are exactly comparable.
+class PathCube {
+public:
+    enum class Precision : uint32_t { Half = 2, Single = 4, Double = 8 };
+
+    // Maps the cube at path if it holds these dates, paths, precision and
+    // seed; otherwise (re)generates it there first. Each writer fills its own
+    // temporary file and renames it into place, so concurrent readers never
+    // see a partial cube and concurrent creators never share a file.
+    static PathCube open_or_create(const std::string& path, std::vector<double> times, uint64_t n_paths,
+                                   Precision precision = Precision::Single, uint64_t seed = 42,
+                                   unsigned n_threads = std::thread::hardware_concurrency()) {
+        const Header want = header_for(times, n_paths, precision, seed);
+        try {
+            PathCube cube(path);
+            if (cube.header_.fingerprint == want.fingerprint) return cube;
+        } catch (const std::runtime_error&) {}
+        generate(path, want, times, seed, std::max(1u, n_threads));
+        PathCube cube(path);
+        cube.created_ = true;
+        return cube;
+    }
+
+    // Maps an existing cube
+    explicit PathCube(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in ? static_cast<uint64_t>(in.tellg()) : 0;
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(&header_), sizeof(Header)) || header_.magic != MAGIC)
+            throw std::runtime_error("PathCube: not a path cube: " + path);
+        // Sizes are checked against the file before anything is allocated
+        const uint64_t width = static_cast<uint64_t>(header_.precision);
+        const uint64_t room = file_size - sizeof(Header);
+        if ((width != 2 && width != 4 && width != 8) || header_.n_obs == 0
+            || header_.n_obs > room / sizeof(double)
+            || header_.n_paths > (room - header_.n_obs * sizeof(double)) / (header_.n_obs * width))
+            throw std::runtime_error("PathCube: truncated " + path);
+        times_.resize(header_.n_obs);
+        in.read(reinterpret_cast<char*>(times_.data()), times_.size() * sizeof(double));
+        if (!in) throw std::runtime_error("PathCube: truncated " + path);
+        for (double t : times_) sqrt_times_.push_back(std::sqrt(t));
+        const std::size_t offset = sizeof(Header) + times_.size() * sizeof(double);
+        const std::size_t bytes = header_.n_paths * header_.n_obs * static_cast<std::size_t>(header_.precision);
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if (fd < 0 || ::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < offset + bytes) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("PathCube: truncated " + path);
+        }
+        void* p = ::mmap(nullptr, offset + bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("PathCube: cannot map " + path);
+        mapping_ = std::shared_ptr<const unsigned char>(static_cast<const unsigned char*>(p),
+                                                        [len = offset + bytes](const unsigned char* q) {
+                                                            ::munmap(const_cast<unsigned char*>(q), len);
+                                                        });
+        data_ = mapping_.get() + offset;
+#else
+        auto buf = std::make_shared<std::vector<unsigned char>>(bytes);
+        if (!in.read(reinterpret_cast<char*>(buf->data()), bytes))
+            throw std::runtime_error("PathCube: truncated " + path);
+        data_ = buf->data();
+        mapping_ = std::shared_ptr<const unsigned char>(buf, buf->data());
+#endif
+    }
+
+    [[nodiscard]] uint64_t n_paths() const noexcept { return header_.n_paths; }
+    [[nodiscard]] std::size_t n_obs() const noexcept { return times_.size(); }
+    [[nodiscard]] const std::vector<double>& times() const noexcept { return times_; }
+    [[nodiscard]] Precision precision() const noexcept { return header_.precision; }
+    [[nodiscard]] bool created() const noexcept { return created_; }    // generated by this open
+    [[nodiscard]] std::size_t bytes() const noexcept {
+        return header_.n_paths * times_.size() * static_cast<std::size_t>(header_.precision);
+    }
+
+    // Brownian values W(t_k) of one path
+    void brownian(uint64_t i, std::span<double> w) const noexcept {
+        const std::size_t n = times_.size(), at = i * n;
+        for (std::size_t k = 0; k < n; ++k) w[k] = load(at + k) * sqrt_times_[k];
+    }
+
+private:
+    static constexpr uint64_t MAGIC = 0x4542554348544150ull;   // "PATHCUBE"
+    static constexpr uint64_t PATHS_PER_WRITE = 1 << 14;
+
+    struct Header {
+        uint64_t  magic;
+        uint64_t  fingerprint;     // of dates, paths, precision and seed
+        uint64_t  n_paths;
+        uint64_t  n_obs;
+        Precision precision;
+        uint32_t  reserved;
+    };
+
+    static Header header_for(const std::vector<double>& times, uint64_t n_paths, Precision precision,
+                             uint64_t seed) {
+        if (times.empty() || times.front() <= 0 || !std::is_sorted(times.begin(), times.end()))
+            throw std::invalid_argument("PathCube: dates must be positive and increasing");
+        uint64_t fp = MCCheckpoint::fingerprint(n_paths, static_cast<uint32_t>(precision), seed, times.size());
+        for (double t : times) fp = MCCheckpoint::fingerprint(fp, t);
+        return {MAGIC, fp, n_paths, times.size(), precision, 0};
+    }
+
+    static void generate(const std::string& path, const Header& h, const std::vector<double>& times,
+                         uint64_t seed, unsigned n_threads) {
+        const std::string tmp = temp_name(path);
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("PathCube: cannot write " + tmp);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(times.data()), times.size() * sizeof(double));
+        const math::Philox4x32 philox(seed);
+        const std::size_t n = times.size(), width = static_cast<std::size_t>(h.precision);
+        std::vector<unsigned char> block(PATHS_PER_WRITE * n * width);
+        for (uint64_t lo = 0; lo < h.n_paths; lo += PATHS_PER_WRITE) {
+            const uint64_t hi = std::min(h.n_paths, lo + PATHS_PER_WRITE);
+            const unsigned nt = static_cast<unsigned>(std::min<uint64_t>(n_threads, hi - lo));
+            run_workers(nt, false, [&](unsigned tid) {
+                for (uint64_t i = lo + tid; i < hi; i += nt) {
+                    double w = 0, t_prev = 0, z1 = 0;
+                    for (std::size_t k = 0; k < n; ++k) {
+                        double z0;
+                        if (k % 2 == 0) std::tie(z0, z1) = philox.normals(i, k / 2);
+                        else            z0 = z1;
+                        w += std::sqrt(times[k] - t_prev) * z0;
+                        t_prev = times[k];
+                        store(block.data(), (i - lo) * n + k, h.precision, w / std::sqrt(times[k]));
+                    }
+                }
+            });
+            out.write(reinterpret_cast<const char*>(block.data()), (hi - lo) * n * width);
+        }
+        out.close();
+        if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("PathCube: cannot write " + path);
+        }
+    }
+
+    // Per-writer temporary next to path: process id (or a random tag off
+    // Linux) and thread id
+    static std::string temp_name(const std::string& path) {
+#ifdef __linux__
+        const uint64_t tag = static_cast<uint64_t>(::getpid());
+#else
+        const uint64_t tag = std::random_device{}();
+#endif
+        return path + ".tmp." + std::to_string(tag) + "."
+               + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    }
+
+    static void store(unsigned char* base, std::size_t idx, Precision p, double z) noexcept {
+        switch (p) {
+            case Precision::Half: {
+                uint16_t v = math::float_to_half(static_cast<float>(z));
+                std::memcpy(base + idx * 2, &v, 2);
+                break;
+            }
+            case Precision::Single: { float v = static_cast<float>(z); std::memcpy(base + idx * 4, &v, 4); break; }
+            case Precision::Double: std::memcpy(base + idx * 8, &z, 8); break;
+        }
+    }
+
+    [[nodiscard]] double load(std::size_t idx) const noexcept {
+        switch (header_.precision) {
+            case Precision::Half: {
+                uint16_t v;
+                std::memcpy(&v, data_ + idx * 2, 2);
+                return math::half_to_float(v);
+            }
+            case Precision::Single: { float v; std::memcpy(&v, data_ + idx * 4, 4); return v; }
+            case Precision::Double: { double v; std::memcpy(&v, data_ + idx * 8, 8); return v; }
+        }
+        return 0.0;
+    }
+
+    Header                               header_{};
+    std::vector<double>                  times_;
+    std::vector<double>                  sqrt_times_;
+    std::shared_ptr<const unsigned char> mapping_;    // keeps the mapping alive across copies
+    const unsigned char*                 data_ = nullptr;
+    bool                                 created_ = false;
+};
+
+// Paths are generated in Real (float halves memory traffic and doubles the
+// SIMD width of the exp/multiply step loop); normals are always drawn in
+// double and rounded, so float and double runs see identical shocks. Payoff
+// values are accumulated in double with compensated sums.
+template <typename Real = double>
+class BasicMonteCarlo {
+public:
+    using real_type = Real;
+
+    BasicMonteCarlo(double S0, double r, double q, double sigma, double T,
+                    MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), sigma_(sigma), T_(T), cfg_(cfg) {}
+
+    // Local-volatility dynamics: σ(t, S) is read from the precomputed grid
+    BasicMonteCarlo(double S0, double r, double q, std::shared_ptr<const LocalVolSurface> local_vol,
+                    double T, MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), sigma_(0.0), T_(T), cfg_(cfg), local_vol_(std::move(local_vol)) {}
+
+    // Type-erased payoff, kept for compatibility
+    MCResult run(const BasicPayoff<Real>& payoff) const {
+        return run<BasicPayoff<Real>>(payoff);
+    }
+
+    // Statically dispatched payoff: the call inlines into the path loop, and
+    // the antithetic flag is lifted to a template parameter of the kernel.
+    template <PathPayoff<Real> P>
+    MCResult run(const P& payoff) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        double dt = T_ / cfg_.n_steps;
+        const Real drift = static_cast<Real>((r_ - q_ - 0.5 * sigma_ * sigma_) * dt);
+        const Real diffusion = static_cast<Real>(sigma_ * std::sqrt(dt));
+        const Real S0 = static_cast<Real>(S0_);
+        double df = std::exp(-r_ * T_);
+
+        // Local vol: one time-interpolated slice per step, built before any path
+        // is simulated; the step loop then only does a lerp in log-spot.
+        const std::vector<LocalVolSurface::Slice> lv_slices = local_vol_slices();
+        const Real sqrt_dt = static_cast<Real>(std::sqrt(dt));
+        const Real mu_dt = static_cast<Real>((r_ - q_) * dt);
+        const Real half_dt = static_cast<Real>(0.5 * dt);
+
+        // Importance sampling: shocks are drawn from N(μ, 1) instead of N(0, 1)
+        // and each path is reweighted by the likelihood ratio
+        //   Π φ(z_s) / φ(z_s - μ) = exp(-μ·Σz_s + n·μ²/2)
+        const double mu = cfg_.drift_shift;
+        const double half_n_mu2 = 0.5 * cfg_.n_steps * mu * mu;
+        auto simulate = [&](std::vector<Real>& path, std::mt19937_64& rng,
+                            std::normal_distribution<double>& N, double sign) {
+            double z_sum = 0.0;
+            path[0] = S0;
+            if (local_vol_) {
+                Real x = std::log(S0);
+                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                    double z = sign * N(rng) + mu;
+                    z_sum += z;
+                    Real sig = static_cast<Real>(lv_slices[s-1].vol(x));
+                    x += mu_dt - half_dt * sig * sig + sig * sqrt_dt * static_cast<Real>(z);
+                    path[s] = std::exp(x);
+                }
+            } else {
+                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                    double z = sign * N(rng) + mu;
+                    z_sum += z;
+                    path[s] = path[s-1] * std::exp(drift + diffusion * static_cast<Real>(z));
+                }
+            }
+            return mu != 0.0 ? std::exp(-mu * z_sum + half_n_mu2) : 1.0;
+        };
+
+        uint64_t paths_per_thread = cfg_.n_paths / cfg_.n_threads;
+        std::vector<CacheAligned<math::KahanSum>> thread_sums(cfg_.n_threads);
+        std::vector<CacheAligned<math::KahanSum>> thread_sq(cfg_.n_threads);
+
+        auto ckpt = open_checkpoint(0);
+        std::optional<MCTelemetry> tel;
+        if (cfg_.observer)
+            tel.emplace(*cfg_.observer, cfg_.n_threads, paths_per_thread * cfg_.n_threads,
+                        cfg_.antithetic ? 2 : 1);
+        std::vector<CacheAligned<uint64_t>> thread_n(cfg_.n_threads);
+
+        auto worker = [&]<bool Antithetic>(unsigned tid) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            math::KahanSum sum, sq;
+            std::vector<Real> path(cfg_.n_steps + 1);
+            const uint64_t p0 = ckpt ? ckpt->restore(tid, rng, N, sum, sq) : 0;
+
+            uint64_t p = p0;
+            for (; p < paths_per_thread; ++p) {
+                if (ckpt && p > p0 && p % cfg_.checkpoint_every == 0)
+                    ckpt->store(tid, p, rng, N, sum, sq);
+                if (tel && p % PUBLISH_EVERY == 0 && !tel->publish(tid, p, sum.value(), sq.value()))
+                    break;
+                double weight = simulate(path, rng, N, 1.0);
+                double pv = df * payoff(path) * weight;
+
+                if constexpr (Antithetic) {
+                    // Antithetic path (negated shocks — approximate via re-sim,
+                    // independent for simplicity)
+                    double weight2 = simulate(path, rng, N, -1.0);
+                    double pv2 = df * payoff(path) * weight2;
+                    pv = 0.5 * (pv + pv2);
+                }
+
+                sum.add(pv);
+                sq.add(pv * pv);
+            }
+            if (tel) tel->publish(tid, p, sum.value(), sq.value());
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+            thread_n[tid].value    = p;
+        };
+
+        return launch(worker, tel, ckpt.get(), thread_sums, thread_sq, thread_n, t0);
+    }
+
+    // Schedule-driven evaluation: the path is simulated in log-spot directly
+    // between the given fixing times with exact GBM transitions, so only
+    // observations cost an exp and a European needs one step (fixings = {T}).
+    // The payoff sees S0 followed by the spot at each fixing; n_steps is
+    // ignored and discounting is to T. Antithetic partners use exactly
+    // negated shocks. drift_shift keeps its meaning on the n_steps grid: the
+    // same Brownian drift rate μ·√(n_steps/T) is applied, i.e. a shift of
+    // μ·√(n_steps·Δt_k/T) on the normal of fixing interval k. Constant vol
+    // only (local vol has no exact transition); checkpointing is not supported.
+    template <PathPayoff<Real> P>
+    MCResult run(const P& payoff, std::span<const double> fixings) const {
+        if (local_vol_) throw std::invalid_argument("run: fixing schedules need constant vol");
+        if (fixings.empty()) throw std::invalid_argument("run: empty fixing schedule");
+        for (std::size_t k = 0; k < fixings.size(); ++k)
+            if (fixings[k] <= (k ? fixings[k-1] : 0.0) || fixings[k] > T_)
+                throw std::invalid_argument("run: fixings must increase within (0, T]");
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const std::size_t n = fixings.size();
+        std::vector<double> drift(n), diffusion(n), shift(n);
+        const double mu = cfg_.drift_shift;                  // importance sampling, as in run()
+        double half_sum_mu2 = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            const double dt = fixings[k] - (k ? fixings[k-1] : 0.0);
+            drift[k] = (r_ - q_ - 0.5 * sigma_ * sigma_) * dt;
+            diffusion[k] = sigma_ * std::sqrt(dt);
+            shift[k] = mu * std::sqrt(cfg_.n_steps * dt / T_);
+            half_sum_mu2 += 0.5 * shift[k] * shift[k];
+        }
+        const double x0 = std::log(S0_);
+        const double df = std::exp(-r_ * T_);
+
+        uint64_t paths_per_thread = cfg_.n_paths / cfg_.n_threads;
+        std::vector<CacheAligned<math::KahanSum>> thread_sums(cfg_.n_threads);
+        std::vector<CacheAligned<math::KahanSum>> thread_sq(cfg_.n_threads);
+        std::optional<MCTelemetry> tel;
+        if (cfg_.observer)
+            tel.emplace(*cfg_.observer, cfg_.n_threads, paths_per_thread * cfg_.n_threads,
+                        cfg_.antithetic ? 2 : 1);
+        std::vector<CacheAligned<uint64_t>> thread_n(cfg_.n_threads);
+
+        auto worker = [&]<bool Antithetic>(unsigned tid) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            math::KahanSum sum, sq;
+            std::vector<double> eps(n);
+            std::vector<Real> path(n + 1);
+            path[0] = static_cast<Real>(S0_);
+            auto value = [&](double sign) {
+                double x = x0, log_lr = half_sum_mu2;
+                for (std::size_t k = 0; k < n; ++k) {
+                    double z = sign * eps[k] + shift[k];
+                    log_lr -= shift[k] * z;
+                    x += drift[k] + diffusion[k] * z;
+                    path[k + 1] = static_cast<Real>(std::exp(x));
+                }
+                double weight = mu != 0.0 ? std::exp(log_lr) : 1.0;
+                return df * payoff(path) * weight;
+            };
+
+            uint64_t p = 0;
+            for (; p < paths_per_thread; ++p) {
+                if (tel && p % PUBLISH_EVERY == 0 && !tel->publish(tid, p, sum.value(), sq.value()))
+                    break;
+                for (auto& e : eps) e = N(rng);
+                double pv = value(1.0);
+                if constexpr (Antithetic) pv = 0.5 * (pv + value(-1.0));
+                sum.add(pv);
+                sq.add(pv * pv);
+            }
+            if (tel) tel->publish(tid, p, sum.value(), sq.value());
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+            thread_n[tid].value    = p;
+        };
+
+        return launch(worker, tel, nullptr, thread_sums, thread_sq, thread_n, t0);
+    }
+
+    // Streaming evaluation: paths advance in blocks of BLOCK with one payoff
+    // state per path and no stored path, so the working set stays in L1.
+    // Antithetic partners (exactly negated shocks) fill the second half of
+    // each block.
+    template <StreamingPayoff P>
+    MCResult run_streaming(const P& proto) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const double dt = T_ / cfg_.n_steps;
+        const double df = std::exp(-r_ * T_);
+        const Real sqrt_dt = static_cast<Real>(std::sqrt(dt));
+        const Real mu_dt = static_cast<Real>((r_ - q_) * dt);
+        const Real half_dt = static_cast<Real>(0.5 * dt);
+        const Real drift = static_cast<Real>((r_ - q_ - 0.5 * sigma_ * sigma_) * dt);
+        const Real diffusion = static_cast<Real>(sigma_ * std::sqrt(dt));
+        const Real x0 = static_cast<Real>(std::log(S0_));
+
+        const std::vector<LocalVolSurface::Slice> lv_slices = local_vol_slices();
+        const double mu = cfg_.drift_shift;                  // importance sampling, as in run()
+        const double half_n_mu2 = 0.5 * cfg_.n_steps * mu * mu;
+
+        uint64_t blocks_per_thread = (cfg_.n_paths / cfg_.n_threads + BLOCK - 1) / BLOCK;
+        std::vector<CacheAligned<math::KahanSum>> thread_sums(cfg_.n_threads);
+        std::vector<CacheAligned<math::KahanSum>> thread_sq(cfg_.n_threads);
+        auto ckpt = open_checkpoint(1);
+        const uint64_t samples_per_block = cfg_.antithetic ? BLOCK / 2 : BLOCK;
+        std::optional<MCTelemetry> tel;
+        if (cfg_.observer)
+            tel.emplace(*cfg_.observer, cfg_.n_threads,
+                        blocks_per_thread * samples_per_block * cfg_.n_threads, cfg_.antithetic ? 2 : 1);
+        std::vector<CacheAligned<uint64_t>> thread_n(cfg_.n_threads);
+
+        auto worker = [&]<bool Antithetic>(unsigned tid) {
+            constexpr std::size_t n_indep = Antithetic ? BLOCK / 2 : BLOCK;
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            alignas(64) Real x[BLOCK], z[BLOCK];
+            alignas(64) double eps[BLOCK], z_sum[BLOCK];
+            std::vector<P> states(BLOCK, proto);
+            math::KahanSum sum, sq;
+            // Checkpoints land on block boundaries; the count stored is in paths
+            const uint64_t blk0 = ckpt ? ckpt->restore(tid, rng, N, sum, sq) / BLOCK : 0;
+            const uint64_t every = std::max<uint64_t>(1, cfg_.checkpoint_every / BLOCK);
+
+            uint64_t blk = blk0;
+            for (; blk < blocks_per_thread; ++blk) {
+                if (ckpt && blk > blk0 && blk % every == 0)
+                    ckpt->store(tid, blk * BLOCK, rng, N, sum, sq);
+                if (tel && !tel->publish(tid, blk * n_indep, sum.value(), sq.value())) break;
+                std::fill_n(x, BLOCK, x0);
+                std::fill_n(z_sum, BLOCK, 0.0);
+                for (auto& st : states) { st.init(); st.observe(0, S0_); }
+
+                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                    for (std::size_t b = 0; b < n_indep; ++b) eps[b] = N(rng);
+                    for (std::size_t b = n_indep; b < BLOCK; ++b) eps[b] = -eps[b - n_indep];
+                    for (std::size_t b = 0; b < BLOCK; ++b) {
+                        z_sum[b] += eps[b] + mu;
+                        z[b] = static_cast<Real>(eps[b] + mu);
+                    }
+                    if (local_vol_) {
+                        const auto& slice = lv_slices[s - 1];
+                        for (std::size_t b = 0; b < BLOCK; ++b) {
+                            Real sig = static_cast<Real>(slice.vol(x[b]));
+                            x[b] += mu_dt - half_dt * sig * sig + sig * sqrt_dt * z[b];
+                        }
+                    } else {
+                        for (std::size_t b = 0; b < BLOCK; ++b) x[b] += drift + diffusion * z[b];
+                    }
+                    for (std::size_t b = 0; b < BLOCK; ++b) states[b].observe(s, std::exp(x[b]));
+                }
+                auto weight = [&](std::size_t b) {
+                    return mu != 0.0 ? std::exp(-mu * z_sum[b] + half_n_mu2) : 1.0;
+                };
+                for (std::size_t b = 0; b < n_indep; ++b) {
+                    double pv = df * states[b].finish() * weight(b);
+                    if constexpr (Antithetic)
+                        pv = 0.5 * (pv + df * states[b + n_indep].finish() * weight(b + n_indep));
+                    sum.add(pv);
+                    sq.add(pv * pv);
+                }
+            }
+            if (tel) tel->publish(tid, blk * n_indep, sum.value(), sq.value());
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+            thread_n[tid].value    = blk * n_indep;
+        };
+
+        return launch(worker, tel, ckpt.get(), thread_sums, thread_sq, thread_n, t0);
+    }
+
+    // One shard of a job split across processes: samples [begin, end) of a
+    // counter-based (Philox) stream, so every sample's normals depend only on
+    // its index and the seed. The job is cfg.n_paths samples; begin must be a
+    // multiple of MCPartial::CHUNK, as must end unless it is cfg.n_paths, so
+    // merged shards line up chunk for chunk. A sample is an antithetic pair
+    // when cfg.antithetic is set. With greeks, delta and gamma come from
+    // central ±1% spot bumps on the same normals.
+    template <PathPayoff<Real> P>
+    MCPartial run_shard(const P& payoff, uint64_t begin, uint64_t end, bool greeks = false,
+                        uint64_t seed = 42) const {
+        if (begin % MCPartial::CHUNK != 0 || end < begin || end > cfg_.n_paths ||
+            (end % MCPartial::CHUNK != 0 && end != cfg_.n_paths))
+            throw std::invalid_argument("run_shard: shard must lie on chunk boundaries within n_paths");
+        const double dt = T_ / cfg_.n_steps;
+        const double df = std::exp(-r_ * T_);
+        const double h  = 0.01 * S0_;
+        const std::vector<LocalVolSurface::Slice> lv_slices = local_vol_slices();
+        const math::Philox4x32 philox(seed);
+
+        MCPartial part;
+        part.fingerprint = MCCheckpoint::fingerprint(sizeof(Real), S0_, r_, q_, sigma_, T_, cfg_.n_steps,
+                                                     cfg_.n_paths, cfg_.antithetic, greeks, seed,
+                                                     local_vol_ != nullptr);
+        part.greeks = greeks;
+        part.total = cfg_.n_paths;
+        const uint64_t first = begin / MCPartial::CHUNK;
+        const uint64_t n_chunks = (end - begin + MCPartial::CHUNK - 1) / MCPartial::CHUNK;
+        part.chunks.resize(n_chunks);
+
+        auto worker = [&](unsigned tid) {
+            std::vector<double> z(cfg_.n_steps + 1);
+            std::vector<Real> path(cfg_.n_steps + 1);
+            auto simulate = [&](double spot, double sign) {
+                double x = std::log(spot);
+                path[0] = static_cast<Real>(spot);
+                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                    double sig = local_vol_ ? lv_slices[s-1].vol(x) : sigma_;
+                    x += (r_ - q_ - 0.5 * sig * sig) * dt + sig * std::sqrt(dt) * sign * z[s];
+                    path[s] = static_cast<Real>(std::exp(x));
+                }
+                return df * payoff(path);
+            };
+            for (uint64_t c = tid; c < n_chunks; c += cfg_.n_threads) {
+                MCPartial::Chunk ch{first + c, 0, 0, 0, 0, 0};
+                uint64_t lo = begin + c * MCPartial::CHUNK, hi = std::min(end, lo + MCPartial::CHUNK);
+                for (uint64_t i = lo; i < hi; ++i) {
+                    for (uint64_t s = 1; s <= cfg_.n_steps; s += 2) {
+                        auto [z0, z1] = philox.normals(i, s / 2);
+                        z[s] = z0;
+                        if (s + 1 <= cfg_.n_steps) z[s + 1] = z1;
+                    }
+                    const int n_signs = cfg_.antithetic ? 2 : 1;
+                    double pv = 0, up = 0, dn = 0;
+                    for (int k = 0; k < n_signs; ++k) {
+                        double sign = k ? -1.0 : 1.0;
+                        pv += simulate(S0_, sign) / n_signs;
+                        if (greeks) {
+                            up += simulate(S0_ + h, sign) / n_signs;
+                            dn += simulate(S0_ - h, sign) / n_signs;
+                        }
+                    }
+                    ++ch.count;
+                    ch.sum += pv;
+                    ch.sq  += pv * pv;
+                    if (greeks) {
+                        ch.delta += (up - dn) / (2.0 * h);
+                        ch.gamma += (up - 2.0 * pv + dn) / (h * h);
+                    }
+                }
+                part.chunks[c] = ch;
+            }
+        };
+        run_workers(cfg_.n_threads, cfg_.pin_threads, worker);
+        return part;
+    }
+
+    // Prices off a persisted path cube: its Brownian values drive exact GBM
+    // transitions between the cube's dates at this engine's S0, r, q and σ,
+    // so runs sharing a cube use common random numbers and a bumped rerun
+    // differs from the base only through the bump. The payoff sees S0
+    // followed by the spot at each cube date (not the engine's step grid).
+    // Sample i reads cube path i, with its negation as the antithetic partner;
+    // n_paths is capped at the cube's path count. drift_shift must be zero:
+    // the stored shocks are unshifted.
+    template <PathPayoff<Real> P>
+    MCResult run(const P& payoff, const PathCube& cube) const {
+        if (local_vol_) throw std::invalid_argument("run: a path cube drives constant-vol GBM only");
+        if (cfg_.drift_shift != 0.0) throw std::invalid_argument("run: a path cube holds unshifted shocks");
+        auto t0 = std::chrono::high_resolution_clock::now();
+        const auto& times = cube.times();
+        const std::size_t n = times.size();
+        std::vector<double> drift(n);
+        for (std::size_t k = 0; k < n; ++k) drift[k] = std::log(S0_) + (r_ - q_ - 0.5 * sigma_ * sigma_) * times[k];
+        const double df = std::exp(-r_ * T_);
+        const uint64_t n_samples = std::min(cfg_.n_paths, cube.n_paths());
+        const uint64_t per_thread = (n_samples + cfg_.n_threads - 1) / cfg_.n_threads;
+
+        std::vector<CacheAligned<math::KahanSum>> thread_sums(cfg_.n_threads), thread_sq(cfg_.n_threads);
+        run_workers(cfg_.n_threads, cfg_.pin_threads, [&](unsigned tid) {
+            std::vector<double> w(n);
+            std::vector<Real> path(n + 1);
+            path[0] = static_cast<Real>(S0_);
+            auto value = [&](double sign) {
+                for (std::size_t k = 0; k < n; ++k)
+                    path[k + 1] = static_cast<Real>(std::exp(drift[k] + sign * sigma_ * w[k]));
+                return df * payoff(path);
+            };
+            math::KahanSum sum, sq;
+            const uint64_t lo = tid * per_thread, hi = std::min(n_samples, lo + per_thread);
+            for (uint64_t i = lo; i < hi; ++i) {
+                cube.brownian(i, w);
+                double pv = value(1.0);
+                if (cfg_.antithetic) pv = 0.5 * (pv + value(-1.0));
+                sum.add(pv);
+                sq.add(pv * pv);
+            }
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value = sq;
+        });
+        return summarise(thread_sums, thread_sq, n_samples, t0);
+    }
+
+    // Most likely path into the payoff region, restricted to a straight line
+    // in the Brownian driver: maximise log payoff(a) - a²/2 over the terminal
+    // shock a with every step shifted by a/√n. Returns the per-step shift
+    // a*/√n for MCConfig::drift_shift, or 0 if no candidate pays anything.
+    template <typename P>
+    double optimal_drift_shift(const P& payoff) const {
+        const double dt = T_ / cfg_.n_steps;
+        const double root_n = std::sqrt(static_cast<double>(cfg_.n_steps));
+        const std::vector<LocalVolSurface::Slice> lv_slices = local_vol_slices();
+        std::vector<Real> path(cfg_.n_steps + 1);
+
+        auto objective = [&](double a) {
+            const double z = a / root_n;
+            double x = std::log(S0_);
+            path[0] = static_cast<Real>(S0_);
+            for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                double sig = local_vol_ ? lv_slices[s-1].vol(x) : sigma_;
+                x += (r_ - q_ - 0.5 * sig * sig) * dt + sig * std::sqrt(dt) * z;
+                path[s] = static_cast<Real>(std::exp(x));
+            }
+            double v;
+            if constexpr (StreamingPayoff<P>) {
+                P st = payoff;
+                st.init();
+                for (uint64_t s = 0; s <= cfg_.n_steps; ++s) st.observe(s, path[s]);
+                v = st.finish();
+            } else {
+                v = payoff(path);
+            }
+            return v > 0.0 ? std::log(v) - 0.5 * a * a : -std::numeric_limits<double>::infinity();
+        };
+
+        constexpr double A_MAX = 8.0, STEP = 0.1;
+        double best_a = 0.0, best_f = -std::numeric_limits<double>::infinity();
+        for (double a = -A_MAX; a <= A_MAX; a += STEP) {
+            double f = objective(a);
+            if (f > best_f) { best_f = f; best_a = a; }
+        }
+        if (!std::isfinite(best_f)) return 0.0;
+
+        // Golden-section refinement around the best grid point
+        constexpr double g = 0.6180339887498949;
+        double lo = best_a - STEP, hi = best_a + STEP;
+        for (int it = 0; it < 40; ++it) {
+            double a1 = hi - g * (hi - lo), a2 = lo + g * (hi - lo);
+            if (objective(a1) >= objective(a2)) hi = a2; else lo = a1;
+        }
+        return 0.5 * (lo + hi) / root_n;
+    }
+
+private:
+    static constexpr std::size_t BLOCK = 64;            // paths per streaming block
+    static constexpr uint64_t    PUBLISH_EVERY = 64;    // samples between telemetry updates
+
+    // Starts the workers (under telemetry if an observer is set) and
+    // summarises over the samples actually taken. A cancelled run keeps its
+    // checkpoint so it can be resumed; a completed one deletes it.
+    template <typename W>
+    MCResult launch(W& worker, std::optional<MCTelemetry>& tel, MCCheckpoint* ckpt,
+                    const std::vector<CacheAligned<math::KahanSum>>& thread_sums,
+                    const std::vector<CacheAligned<math::KahanSum>>& thread_sq,
+                    const std::vector<CacheAligned<uint64_t>>& thread_n,
+                    std::chrono::high_resolution_clock::time_point t0) const {
+        auto body = [&](unsigned t) {
+            if (cfg_.antithetic) worker.template operator()<true>(t);
+            else                 worker.template operator()<false>(t);
+        };
+        if (tel) tel->run(cfg_.n_threads, cfg_.pin_threads, cfg_.report_interval_ms, body);
+        else     run_workers(cfg_.n_threads, cfg_.pin_threads, body);
+
+        // Cancelled means the workers stopped short, not merely that the
+        // observer asked to stop after the last sample was taken
+        uint64_t N = 0;
+        for (auto& n : thread_n) N += n.value;
+        const bool cancelled = tel && N < tel->samples_total();
+        if (ckpt && !cancelled) ckpt->remove();
+        MCResult res = summarise(thread_sums, thread_sq, N, t0);
+        res.cancelled = cancelled;
+        return res;
+    }
+
+    // Checkpoint for this run if one is configured, loaded if a matching file
+    // exists; mode tells run() and run_streaming() checkpoints apart
+    [[nodiscard]] std::unique_ptr<MCCheckpoint> open_checkpoint(int mode) const {
+        if (cfg_.checkpoint_path.empty() || cfg_.checkpoint_every == 0) return nullptr;
+        uint64_t fp = MCCheckpoint::fingerprint(mode, sizeof(Real), S0_, r_, q_, sigma_, T_,
+                                                cfg_.n_paths, cfg_.n_steps, cfg_.antithetic,
+                                                cfg_.drift_shift, cfg_.n_threads,
+                                                local_vol_ != nullptr);
+        auto ckpt = std::make_unique<MCCheckpoint>(cfg_.checkpoint_path, fp, cfg_.n_threads);
+        ckpt->load();
+        ckpt->save();
+        return ckpt;
+    }
+
+    [[nodiscard]] std::vector<LocalVolSurface::Slice> local_vol_slices() const {
+        std::vector<LocalVolSurface::Slice> slices;
+        if (!local_vol_) return slices;
+        const double dt = T_ / cfg_.n_steps;
+        slices.reserve(cfg_.n_steps);
+        for (uint64_t s = 0; s < cfg_.n_steps; ++s)
+            slices.push_back(local_vol_->slice(s * dt));
+        return slices;
+    }
+
+    // No samples (cancelled before the first, or fewer paths than threads)
+    // gives price 0 with an infinite standard error
+    static MCResult summarise(const std::vector<CacheAligned<math::KahanSum>>& thread_sums,
+                              const std::vector<CacheAligned<math::KahanSum>>& thread_sq, uint64_t N,
+                              std::chrono::high_resolution_clock::time_point t0) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (N == 0) return {0.0, std::numeric_limits<double>::infinity(), ms};
+
+        math::KahanSum total_sum, total_sq;
+        for (std::size_t t = 0; t < thread_sums.size(); ++t) {
+            total_sum.add(thread_sums[t].value.value());
+            total_sq.add(thread_sq[t].value.value());
+        }
+
+        double mean = total_sum.value() / N;
+        double var  = std::max((total_sq.value() / N) - mean * mean, 0.0);
+        double se   = std::sqrt(var / N);
+
+        return {mean, se, ms};
+    }
+
+    double S0_, r_, q_, sigma_, T_;
+    MCConfig cfg_;
+    std::shared_ptr<const LocalVolSurface> local_vol_;
+};
+
+using MonteCarlo = BasicMonteCarlo<double>;
+
+// Float-vs-double agreement check. Both runs consume the same normals, so
+// their difference is pure rounding error and should be a small fraction of
+// the statistical error; `passed` gates enabling float for a trade type.
+struct PrecisionCheck {
+    MCResult single;          // float paths
+    MCResult full;            // double paths
+    double   error_ratio;     // |price_f - price_d| / std_error_d
+    bool     passed;
+};
+
+template <typename F>
+PrecisionCheck check_precision(double S0, double r, double q, double sigma, double T,
+                               const F& payoff, MCConfig cfg = {}, double max_ratio = 0.25) {
+    auto single = BasicMonteCarlo<float>(S0, r, q, sigma, T, cfg).run(payoff);
+    auto full   = BasicMonteCarlo<double>(S0, r, q, sigma, T, cfg).run(payoff);
+    double ratio = std::fabs(single.price - full.price) / std::max(full.std_error, 1e-300);
+    return { single, full, ratio, ratio <= max_ratio };
+}
+
+// ============================================================================
+// §5a  Least-Squares Monte Carlo (Longstaff-Schwartz early exercise)
+// ============================================================================
+// Spots are simulated only on the exercise dates, using exact GBM transitions,
+// and stored date-major ([date][path]) so each backward-induction step streams
+// one contiguous column. The continuation value is regressed on 1, x, x²
+// (x = S/K) over in-the-money paths; the normal equations are accumulated per
+// thread from small SoA blocks of basis columns and reduced before the solve.
+class LongstaffSchwartz {
+public:
+    static constexpr std::size_t N_BASIS = 3;
+    static constexpr std::size_t BLOCK   = 256;   // paths per basis-column block
+
+    LongstaffSchwartz(double S0, double r, double q, double sigma, MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), sigma_(sigma), cfg_(cfg) {}
+
+    MCResult run(OptionType type, double K, std::vector<double> exercise_dates) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        std::sort(exercise_dates.begin(), exercise_dates.end());
+        exercise_dates.erase(std::unique(exercise_dates.begin(), exercise_dates.end()),
+                             exercise_dates.end());
+        if (exercise_dates.empty() || exercise_dates.front() <= 0.0)
+            throw std::invalid_argument("LongstaffSchwartz: exercise dates must be positive");
+
+        const std::size_t n_dates = exercise_dates.size();
+        const unsigned n_threads = std::max(1u, cfg_.n_threads);
+        const uint64_t stride = cfg_.antithetic ? 2 : 1;       // antithetic pairs are adjacent
+        const uint64_t n_paths = (cfg_.n_paths / stride) * stride;
+        // Even chunk size keeps every antithetic pair inside one thread's range
+        const uint64_t chunk = ((n_paths + n_threads - 1) / n_threads + 1) & ~uint64_t{1};
+
+        auto intrinsic = [type, K](double S) {
+            return type == OptionType::Call ? std::max(S - K, 0.0) : std::max(K - S, 0.0);
+        };
+        auto parallel = [&](auto&& fn) {
+            run_workers(n_threads, cfg_.pin_threads, [&](unsigned t) {
+                uint64_t lo = std::min(n_paths, t * chunk);
+                uint64_t hi = std::min(n_paths, lo + chunk);
+                fn(t, lo, hi);
+            });
+        };
+
+        // Left uninitialised so each worker's path range is first touched, and
+        // so placed, by the thread that will keep using it
+        auto spots = std::make_unique_for_overwrite<double[]>(n_dates * n_paths);   // [date][path]
+        auto value = std::make_unique_for_overwrite<double[]>(n_paths);   // realised cash-flow, PV at t = 0
+
+        // Forward pass: simulate spots date by date, seed cash-flows with the
+        // terminal payoff.
+        parallel([&](unsigned tid, uint64_t lo, uint64_t hi) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            double t_prev = 0.0;
+            for (std::size_t d = 0; d < n_dates; ++d) {
+                double dt = exercise_dates[d] - t_prev;
+                double drift = (r_ - q_ - 0.5 * sigma_ * sigma_) * dt;
+                double diffusion = sigma_ * std::sqrt(dt);
+                const double* prev = d ? &spots[(d - 1) * n_paths] : nullptr;
+                double* cur = &spots[d * n_paths];
+                for (uint64_t p = lo; p < hi; p += stride) {
+                    double z = N(rng);
+                    cur[p] = (prev ? prev[p] : S0_) * std::exp(drift + diffusion * z);
+                    if (stride == 2)
+                        cur[p + 1] = (prev ? prev[p + 1] : S0_) * std::exp(drift - diffusion * z);
+                }
+                t_prev = exercise_dates[d];
+            }
+            double df = std::exp(-r_ * exercise_dates.back());
+            const double* last = &spots[(n_dates - 1) * n_paths];
+            for (uint64_t p = lo; p < hi; ++p) value[p] = df * intrinsic(last[p]);
+        });
+
+        // Backward induction over the remaining exercise dates
+        constexpr std::size_t NB = N_BASIS;
+        struct alignas(CACHE_LINE) Normal { double gram[NB * NB]; double rhs[NB]; uint64_t n_itm; };
+        std::vector<Normal> partial(n_threads);
+
+        for (std::size_t d = n_dates - 1; d-- > 0;) {
+            const double* col = &spots[d * n_paths];
+            const double df = std::exp(-r_ * exercise_dates[d]);
+
+            parallel([&](unsigned tid, uint64_t lo, uint64_t hi) {
+                Normal ne{};
+                alignas(64) double basis[NB][BLOCK];
+                alignas(64) double y[BLOCK];
+                std::size_t m = 0;
+                auto flush = [&] {
+                    for (std::size_t i = 0; i < NB; ++i) {
+                        for (std::size_t j = 0; j <= i; ++j) {
+                            double s = 0;
+                            for (std::size_t b = 0; b < m; ++b) s += basis[i][b] * basis[j][b];
+                            ne.gram[i * NB + j] += s;
+                        }
+                        double s = 0;
+                        for (std::size_t b = 0; b < m; ++b) s += basis[i][b] * y[b];
+                        ne.rhs[i] += s;
+                    }
+                    ne.n_itm += m;
+                    m = 0;
+                };
+                for (uint64_t p = lo; p < hi; ++p) {
+                    if (intrinsic(col[p]) <= 0.0) continue;
+                    double x = col[p] / K, xk = 1.0;
+                    for (std::size_t k = 0; k < NB; ++k) { basis[k][m] = xk; xk *= x; }
+                    y[m] = value[p];
+                    if (++m == BLOCK) flush();
+                }
+                flush();
+                partial[tid] = ne;
+            });
+
+            Normal total{};
+            for (auto& ne : partial) {
+                for (std::size_t i = 0; i < NB * NB; ++i) total.gram[i] += ne.gram[i];
+                for (std::size_t i = 0; i < NB; ++i)     total.rhs[i]  += ne.rhs[i];
+                total.n_itm += ne.n_itm;
+            }
+            if (total.n_itm < 4 * NB) continue;   // too few ITM paths to regress
+
+            std::vector<double> G(NB * NB), beta(total.rhs, total.rhs + NB);
+            double trace = 0;
+            for (std::size_t i = 0; i < NB; ++i) {
+                for (std::size_t j = 0; j <= i; ++j)
+                    G[i * NB + j] = G[j * NB + i] = total.gram[i * NB + j];
+                trace += G[i * NB + i];
+            }
+            for (std::size_t i = 0; i < NB; ++i) G[i * NB + i] += 1e-12 * trace;
+            math::cholesky(G, NB);
+            math::cholesky_solve(G, NB, beta);
+
+            parallel([&](unsigned, uint64_t lo, uint64_t hi) {
+                for (uint64_t p = lo; p < hi; ++p) {
+                    double h = intrinsic(col[p]);
+                    if (h <= 0.0) continue;
+                    double x = col[p] / K, xk = 1.0, cont = 0.0;
+                    for (std::size_t k = 0; k < NB; ++k) { cont += beta[k] * xk; xk *= x; }
+                    double exercise = df * h;
+                    if (exercise > cont) value[p] = exercise;
+                }
+            });
+        }
+
+        // Estimator: antithetic pairs are averaged before the variance estimate
+        std::vector<CacheAligned<double>> thread_sums(n_threads);
+        std::vector<CacheAligned<double>> thread_sq(n_threads);
+        parallel([&](unsigned tid, uint64_t lo, uint64_t hi) {
+            double sum = 0, sq = 0;
+            for (uint64_t p = lo; p < hi; p += stride) {
+                double pv = stride == 2 ? 0.5 * (value[p] + value[p + 1]) : value[p];
+                sum += pv;
+                sq  += pv * pv;
+            }
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+        });
+
+        double total_sum = 0, total_sq = 0;
+        for (std::size_t t = 0; t < thread_sums.size(); ++t) {
+            total_sum += thread_sums[t].value;
+            total_sq  += thread_sq[t].value;
+        }
+        uint64_t N = n_paths / stride;
+
+        double mean = total_sum / N;
+        double var  = (total_sq / N) - mean * mean;
+        double se   = std::sqrt(var / N);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+        return {mean, se, ms};
+    }
+
+private:
+    double S0_, r_, q_, sigma_;
+    MCConfig cfg_;
+};
+
+// Evenly spaced exercise dates (T/n, 2T/n, ..., T); a fine schedule
+// approximates an American option.
+std::vector<double> exercise_schedule(double expiry, int n) {
+    std::vector<double> dates(n);
+    for (int i = 0; i < n; ++i) dates[i] = expiry * (i + 1) / n;
+    return dates;
+}
+
+// ============================================================================
+// §5b  Finite-Difference Engine (Crank-Nicolson, one factor)
+// ============================================================================
+struct FDConfig {
+    std::size_t n_space          = 300;    // spot intervals
+    std::size_t n_time           = 200;    // time steps
+    std::size_t rannacher_steps  = 2;      // leading CN steps replaced by implicit half-steps
+    double      cluster_width    = 0.05;   // grid concentration width, fraction of spot
+    double      n_std_devs       = 5.0;    // far boundaries at ±n·σ√T in log-spot
+    uint64_t    monitoring_steps = 252;    // discrete barrier fixings (BGK shift), 0 = continuous
+};
+
+struct FDResult {
+    double price;
+    double delta;
+    double gamma;
+    double theta;         // per calendar day, as in BSResult
+    double elapsed_ms;
+};
+
+// Solves the Black-Scholes PDE in time-to-expiry τ on a non-uniform spot grid
+// clustered (sum of sinh maps) around the strike, the spot and any barrier.
+// Crank-Nicolson and the Rannacher implicit half-steps share the same LHS
+// matrix I - ½Δτ·L, so a single Thomas factorisation serves the whole solve.
+class FiniteDifference {
+public:
+    FiniteDifference(double S0, double r, double q, double sigma, FDConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), sigma_(sigma), cfg_(cfg) {}
+
+    [[nodiscard]] FDResult vanilla(OptionType type, double K, double T) const {
+        auto [lo, hi] = domain(K, T);
+        return solve({type, K, T, lo, hi, false, false, {K, S0_}, {}});
+    }
+
+    [[nodiscard]] FDResult bermudan(OptionType type, double K, double T,
+                                    std::vector<double> exercise_dates) const {
+        auto [lo, hi] = domain(K, T);
+        return solve({type, K, T, lo, hi, false, false, {K, S0_}, std::move(exercise_dates)});
+    }
+
+    // Knock-outs are solved directly with an absorbing boundary at the
+    // (monitoring-adjusted) barrier; knock-ins follow from in-out parity.
+    [[nodiscard]] FDResult barrier(OptionType type, double K, double T, double B,
+                                   bool knock_in, bool up) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        FDResult ko{0.0, 0.0, 0.0, 0.0, 0.0};
+        bool breached = up ? S0_ >= B : S0_ <= B;
+        if (!breached) {
+            // Broadie-Glasserman-Kou: discrete monitoring ≈ continuous barrier
+            // shifted away from the spot by 0.5826·σ·√Δt
+            double shift = cfg_.monitoring_steps
+                ? std::exp(0.5826 * sigma_ * std::sqrt(T / cfg_.monitoring_steps)) : 1.0;
+            double B_eff = up ? B * shift : B / shift;
+            auto [lo, hi] = domain(K, T);
+            if (up) hi = B_eff; else lo = B_eff;
+            ko = solve({type, K, T, lo, hi, !up, up, {K, S0_, B_eff}, {}});
+        }
+
+        FDResult res = ko;
+        if (knock_in) {
+            auto bs = black_scholes(type, S0_, K, T, r_, q_, sigma_);
+            res.price = bs.price - ko.price;
+            res.delta = bs.delta - ko.delta;
+            res.gamma = bs.gamma - ko.gamma;
+            res.theta = bs.theta - ko.theta;
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        res.elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        return res;
+    }
+
+private:
+    struct Problem {
+        OptionType          type;
+        double              K, T;
+        double              s_lo, s_hi;
+        bool                lo_absorbing, hi_absorbing;   // knock-out barrier at boundary
+        std::vector<double> centres;                      // grid concentration points
+        std::vector<double> exercise_dates;               // early exercise (calendar time)
+    };
+
+    [[nodiscard]] std::pair<double,double> domain(double K, double T) const {
+        double width = cfg_.n_std_devs * sigma_ * std::sqrt(T);
+        return { std::min(S0_, K) * std::exp(-width), std::max(S0_, K) * std::exp(width) };
+    }
+
+    // Nodes S_j = G⁻¹(G(lo) + j/n·(G(hi) - G(lo))) with G(S) = Σ_c asinh((S - c)/w):
+    // spacing ≈ w·ΔG near each centre, growing linearly away from them.
+    [[nodiscard]] std::vector<double> make_grid(double lo, double hi,
+                                                const std::vector<double>& centres) const {
+        const std::size_t n = cfg_.n_space;
+        const double w = cfg_.cluster_width * S0_;
+        auto G  = [&](double S) { double g = 0; for (double c : centres) g += std::asinh((S - c) / w); return g; };
+        auto dG = [&](double S) { double g = 0; for (double c : centres) g += 1.0 / std::hypot(S - c, w); return g; };
+
+        std::vector<double> S(n + 1);
+        S[0] = lo; S[n] = hi;
+        double g_lo = G(lo), g_hi = G(hi);
+        for (std::size_t j = 1; j < n; ++j) {
+            double target = g_lo + (g_hi - g_lo) * j / n;
+            double x = S[j-1];
+            for (int it = 0; it < 50; ++it) {
+                double dx = (G(x) - target) / dG(x);
+                x = std::clamp(x - dx, S[j-1], hi);
+                if (std::fabs(dx) < 1e-12 * S0_) break;
+            }
+            S[j] = x;
+        }
+        // Put a node exactly on every interior centre (payoff kink, spot)
+        for (double c : centres) {
+            if (c <= lo || c >= hi) continue;
+            auto it = std::lower_bound(S.begin() + 1, S.end() - 1, c);
+            // Interior nodes only: past S[n-1] the nearest movable node is n-1
+            std::size_t j = std::min<std::size_t>(it - S.begin(), n - 1);
+            if (j > 1 && c - S[j-1] < S[j] - c) --j;
+            if (S[j-1] < c && c < S[j+1]) S[j] = c;
+        }
+        return S;
+    }
+
+    [[nodiscard]] FDResult solve(const Problem& pb) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const std::vector<double> S = make_grid(pb.s_lo, pb.s_hi, pb.centres);
+        const std::size_t n = cfg_.n_space;
+        const std::size_t m = n - 1;                 // interior unknowns 1..n-1
+        const double dt = pb.T / cfg_.n_time;
+        const double half = 0.5 * dt;
+        const bool call = pb.type == OptionType::Call;
+
+        auto intrinsic = [&](double s) { return call ? std::max(s - pb.K, 0.0) : std::max(pb.K - s, 0.0); };
+        // Far-field Dirichlet values: discounted forward intrinsic
+        auto far_field = [&](double s, double tau) {
+            double fwd = s * std::exp(-q_ * tau) - pb.K * std::exp(-r_ * tau);
+            return std::max(call ? fwd : -fwd, 0.0);
+        };
+
+        // Operator L = ½σ²S²∂² + (r-q)S∂ - r on the non-uniform grid
+        std::vector<double> a(m), b(m), c(m);
+        for (std::size_t i = 1; i < n; ++i) {
+            double hm = S[i] - S[i-1], hp = S[i+1] - S[i];
+            double diff = 0.5 * sigma_ * sigma_ * S[i] * S[i];
+            double conv = (r_ - q_) * S[i];
+            a[i-1] = diff * 2.0 / (hm * (hm + hp)) - conv * hp / (hm * (hm + hp));
+            b[i-1] = -diff * 2.0 / (hm * hp)      + conv * (hp - hm) / (hm * hp) - r_;
+            c[i-1] = diff * 2.0 / (hp * (hm + hp)) + conv * hm / (hp * (hm + hp));
+        }
+        std::vector<double> lo_diag(m), diag(m), up_diag(m);
+        for (std::size_t i = 0; i < m; ++i) {
+            lo_diag[i] = -half * a[i];
+            diag[i]    = 1.0 - half * b[i];
+            up_diag[i] = -half * c[i];
+        }
+        const math::Tridiagonal lhs(lo_diag, diag, up_diag);
+
+        // Exercise dates mapped to τ-step indices (t = 0 is not exercisable)
+        std::vector<char> exercise(cfg_.n_time + 1, 0);
+        for (double te : pb.exercise_dates) {
+            if (te <= 0.0 || te > pb.T) continue;
+            auto k = static_cast<std::size_t>(std::lround((pb.T - te) / dt));
+            exercise[std::min(k, cfg_.n_time - 1)] = 1;
+        }
+
+        std::vector<double> V(n + 1), V_prev, rhs(m);
+        for (std::size_t i = 0; i <= n; ++i) V[i] = intrinsic(S[i]);
+        if (pb.lo_absorbing) V[0] = 0.0;
+        if (pb.hi_absorbing) V[n] = 0.0;
+
+        auto boundary = [&](double tau) {
+            V[0] = pb.lo_absorbing ? 0.0 : far_field(S[0], tau);
+            V[n] = pb.hi_absorbing ? 0.0 : far_field(S[n], tau);
+        };
+        // One θ-step of length h: θ = 1 (implicit, h = Δτ/2) or θ = ½ (CN, h = Δτ)
+        auto step = [&](double tau_new, bool implicit) {
+            if (implicit) {
+                for (std::size_t i = 0; i < m; ++i) rhs[i] = V[i+1];
+            } else {
+                for (std::size_t i = 0; i < m; ++i)
+                    rhs[i] = V[i+1] + half * (a[i] * V[i] + b[i] * V[i+1] + c[i] * V[i+2]);
+            }
+            boundary(tau_new);
+            rhs[0]     += half * a[0]     * V[0];
+            rhs[m - 1] += half * c[m - 1] * V[n];
+            lhs.solve(rhs);
+            std::copy(rhs.begin(), rhs.end(), V.begin() + 1);
+        };
+
+        for (std::size_t k = 1; k <= cfg_.n_time; ++k) {
+            if (k == cfg_.n_time) V_prev = V;
+            double tau = k * dt;
+            if (k <= cfg_.rannacher_steps) {
+                step(tau - half, true);
+                step(tau, true);
+            } else {
+                step(tau, false);
+            }
+            if (exercise[k])
+                for (std::size_t i = 0; i <= n; ++i) V[i] = std::max(V[i], intrinsic(S[i]));
+        }
+
+        // Quadratic interpolation through the three nodes nearest S0
+        std::size_t j = std::lower_bound(S.begin(), S.end(), S0_) - S.begin();
+        if (j > 0 && (j > n || S0_ - S[j-1] < S[j] - S0_)) --j;
+        j = std::clamp<std::size_t>(j, 1, n - 1);
+        const double x0 = S[j-1], x1 = S[j], x2 = S[j+1];
+        auto interp = [&](const std::vector<double>& U, double& val, double& d1, double& d2) {
+            double l0 = U[j-1] / ((x0 - x1) * (x0 - x2));
+            double l1 = U[j]   / ((x1 - x0) * (x1 - x2));
+            double l2 = U[j+1] / ((x2 - x0) * (x2 - x1));
+            double s = S0_;
+            val = l0 * (s - x1) * (s - x2) + l1 * (s - x0) * (s - x2) + l2 * (s - x0) * (s - x1);
+            d1  = l0 * (2*s - x1 - x2) + l1 * (2*s - x0 - x2) + l2 * (2*s - x0 - x1);
+            d2  = 2.0 * (l0 + l1 + l2);
+        };
+
+        FDResult res{};
+        interp(V, res.price, res.delta, res.gamma);
+        double prev_price, unused1, unused2;
+        interp(V_prev, prev_price, unused1, unused2);
+        res.theta = (prev_price - res.price) / dt / 365.0;   // calendar time runs against τ
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        res.elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        return res;
+    }
+
+    double S0_, r_, q_, sigma_;
+    FDConfig cfg_;
+};
+
+// ============================================================================
+// §5c  Multi-Asset Monte Carlo (correlated GBM, basket / rainbow payoffs)
+// ============================================================================
+// Read-only view of one simulated path, laid out [asset][step]
+class MultiPathView {
+public:
+    MultiPathView(const double* data, std::size_t n_assets, std::size_t n_points)
+        : data_(data), n_assets_(n_assets), n_points_(n_points) {}
+
+    [[nodiscard]] std::size_t n_assets() const { return n_assets_; }
+    [[nodiscard]] std::size_t n_points() const { return n_points_; }
+
+    [[nodiscard]] std::span<const double> asset(std::size_t i) const {
+        return { data_ + i * n_points_, n_points_ };
+    }
+    [[nodiscard]] double operator()(std::size_t i, std::size_t step) const {
+        return data_[i * n_points_ + step];
+    }
+    [[nodiscard]] double terminal(std::size_t i) const { return (*this)(i, n_points_ - 1); }
+
+private:
+    const double* data_;
+    std::size_t   n_assets_, n_points_;
+};
+
+using MultiPayoff = std::function<double(const MultiPathView&)>;
+
+// The correlation matrix is factored once at construction. Paths are simulated
+// in blocks: each step draws an [asset][path] block of iid normals and applies
+// the Cholesky factor as a lower-triangular matrix times that block, with the
+// innermost loop running over contiguous paths so it vectorises.
+class MultiAssetMonteCarlo {
+public:
+    static constexpr std::size_t BLOCK = 32;   // paths simulated together
+
+    MultiAssetMonteCarlo(std::vector<double> S0, double r, std::vector<double> q,
+                         std::vector<double> sigma, std::vector<double> correlation,
+                         double T, MCConfig cfg = {})
+        : S0_(std::move(S0)), r_(r), q_(std::move(q)), sigma_(std::move(sigma)),
+          chol_(std::move(correlation)), T_(T), cfg_(cfg)
+    {
+        const std::size_t n = S0_.size();
+        if (q_.size() != n || sigma_.size() != n || chol_.size() != n * n)
+            throw std::invalid_argument("MultiAssetMonteCarlo: inconsistent dimensions");
+        math::cholesky(chol_, n);
+    }
+
+    [[nodiscard]] std::size_t n_assets() const { return S0_.size(); }
+
+    MCResult run(const MultiPayoff& payoff) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const std::size_t n = S0_.size();
+        const std::size_t n_pts = cfg_.n_steps + 1;
+        const double dt = T_ / cfg_.n_steps;
+        const double df = std::exp(-r_ * T_);
+
+        std::vector<double> drift(n), diffusion(n), log_S0(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            drift[i]     = (r_ - q_[i] - 0.5 * sigma_[i] * sigma_[i]) * dt;
+            diffusion[i] = sigma_[i] * std::sqrt(dt);
+            log_S0[i]    = std::log(S0_[i]);
+        }
+
+        // Antithetic partners live in the second half of each block
+        const std::size_t n_indep = cfg_.antithetic ? BLOCK / 2 : BLOCK;
+        uint64_t blocks_per_thread = (cfg_.n_paths / cfg_.n_threads + BLOCK - 1) / BLOCK;
+        std::vector<CacheAligned<double>> thread_sums(cfg_.n_threads);
+        std::vector<CacheAligned<double>> thread_sq(cfg_.n_threads);
+
+        auto worker = [&](unsigned tid) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            alignas(64) double z[BLOCK];
+            std::vector<double> Z(n * BLOCK);          // [asset][path]
+            std::vector<double> log_S(n * BLOCK);      // [asset][path]
+            std::vector<double> paths(BLOCK * n * n_pts);   // [path][asset][step]
+            double sum = 0, sq = 0;
+
+            for (uint64_t blk = 0; blk < blocks_per_thread; ++blk) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::fill_n(&log_S[i * BLOCK], BLOCK, log_S0[i]);
+                    for (std::size_t b = 0; b < BLOCK; ++b) paths[(b * n + i) * n_pts] = S0_[i];
+                }
+                for (std::size_t s = 1; s < n_pts; ++s) {
+                    for (std::size_t j = 0; j < n; ++j) {
+                        double* Zj = &Z[j * BLOCK];
+                        for (std::size_t b = 0; b < n_indep; ++b) Zj[b] = N(rng);
+                        for (std::size_t b = n_indep; b < BLOCK; ++b) Zj[b] = -Zj[b - n_indep];
+                    }
+                    // Correlate: row i of L (i+1 non-zeros) times the normal block
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const double* Li = &chol_[i * n];
+                        std::fill_n(z, BLOCK, 0.0);
+                        for (std::size_t j = 0; j <= i; ++j) {
+                            const double l = Li[j];
+                            const double* Zj = &Z[j * BLOCK];
+                            for (std::size_t b = 0; b < BLOCK; ++b) z[b] += l * Zj[b];
+                        }
+                        double* x = &log_S[i * BLOCK];
+                        for (std::size_t b = 0; b < BLOCK; ++b) {
+                            x[b] += drift[i] + diffusion[i] * z[b];
+                            paths[(b * n + i) * n_pts + s] = std::exp(x[b]);
+                        }
+                    }
+                }
+                double pv[BLOCK];
+                for (std::size_t b = 0; b < BLOCK; ++b)
+                    pv[b] = df * payoff(MultiPathView(&paths[b * n * n_pts], n, n_pts));
+                for (std::size_t b = 0; b < n_indep; ++b) {
+                    double v = cfg_.antithetic ? 0.5 * (pv[b] + pv[b + n_indep]) : pv[b];
+                    sum += v;
+                    sq  += v * v;
+                }
+            }
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+        };
+
+        run_workers(cfg_.n_threads, cfg_.pin_threads, worker);
+
+        double total_sum = 0, total_sq = 0;
+        for (std::size_t t = 0; t < thread_sums.size(); ++t) {
+            total_sum += thread_sums[t].value;
+            total_sq  += thread_sq[t].value;
+        }
+        uint64_t N = blocks_per_thread * n_indep * cfg_.n_threads;
+
+        double mean = total_sum / N;
+        double var  = (total_sq / N) - mean * mean;
+        double se   = std::sqrt(var / N);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+        return {mean, se, ms};
+    }
+
+private:
+    std::vector<double> S0_;
+    double              r_;
+    std::vector<double> q_, sigma_;
+    std::vector<double> chol_;        // lower Cholesky factor of the correlation matrix
+    double              T_;
+    MCConfig            cfg_;
+};
+
+// ============================================================================
+// §5d  Heston Stochastic Volatility (QE Monte Carlo + semi-analytic vanillas)
+// ============================================================================
+struct HestonParams {
+    double v0;       // initial variance
+    double kappa;    // mean-reversion speed
+    double theta;    // long-run variance
+    double xi;       // vol of variance
+    double rho;      // spot / variance correlation
+};
+
+// Andersen's Quadratic-Exponential scheme with the martingale-corrected log-spot
+// step. Variance is moment-matched to a squared Gaussian (ψ ≤ 1.5) or to a
+// mass-at-zero exponential (ψ > 1.5), so coarse steps remain accurate. Paths
+// are advanced as SoA blocks; the second half of each block is antithetic.
+class HestonMonteCarlo {
+public:
+    static constexpr std::size_t BLOCK = 64;
+    static constexpr double PSI_C = 1.5;
+
+    HestonMonteCarlo(double S0, double r, double q, HestonParams p, double T, MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), p_(p), T_(T), cfg_(cfg) {}
+
+    MCResult run(const Payoff& payoff) const {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const double dt = T_ / cfg_.n_steps;
+        const double df = std::exp(-r_ * T_);
+        const double ekt = std::exp(-p_.kappa * dt);
+        const double xi2 = p_.xi * p_.xi;
+        // Central discretisation of the integrated variance (γ1 = γ2 = ½)
+        const double K0 = -p_.rho * p_.kappa * p_.theta / p_.xi * dt;
+        const double K1 = 0.5 * dt * (p_.kappa * p_.rho / p_.xi - 0.5) - p_.rho / p_.xi;
+        const double K2 = 0.5 * dt * (p_.kappa * p_.rho / p_.xi - 0.5) + p_.rho / p_.xi;
+        const double K3 = 0.5 * dt * (1.0 - p_.rho * p_.rho);
+        const double K4 = K3;
+        const double A  = K2 + 0.5 * K4;
+        const double mu_dt = (r_ - q_) * dt;
+
+        const std::size_t n_indep = cfg_.antithetic ? BLOCK / 2 : BLOCK;
+        uint64_t blocks_per_thread = (cfg_.n_paths / cfg_.n_threads + BLOCK - 1) / BLOCK;
+        std::vector<CacheAligned<double>> thread_sums(cfg_.n_threads);
+        std::vector<CacheAligned<double>> thread_sq(cfg_.n_threads);
+
+        auto worker = [&](unsigned tid) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            std::uniform_real_distribution<double> U(0.0, 1.0);
+            alignas(64) double x[BLOCK], v[BLOCK], zv[BLOCK], zs[BLOCK], u[BLOCK];
+            std::vector<std::vector<double>> paths(BLOCK, std::vector<double>(cfg_.n_steps + 1));
+            double sum = 0, sq = 0;
+
+            for (uint64_t blk = 0; blk < blocks_per_thread; ++blk) {
+                std::fill_n(x, BLOCK, std::log(S0_));
+                std::fill_n(v, BLOCK, p_.v0);
+                for (auto& path : paths) path[0] = S0_;
+
+                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
+                    for (std::size_t b = 0; b < n_indep; ++b) {
+                        zv[b] = N(rng); zs[b] = N(rng); u[b] = U(rng);
+                    }
+                    for (std::size_t b = n_indep; b < BLOCK; ++b) {
+                        zv[b] = -zv[b - n_indep]; zs[b] = -zs[b - n_indep]; u[b] = 1.0 - u[b - n_indep];
+                    }
+                    for (std::size_t b = 0; b < BLOCK; ++b) {
+                        double vb = v[b];
+                        double m  = p_.theta + (vb - p_.theta) * ekt;
+                        double s2 = vb * xi2 * ekt / p_.kappa * (1.0 - ekt)
+                                  + p_.theta * xi2 / (2.0 * p_.kappa) * (1.0 - ekt) * (1.0 - ekt);
+                        double psi = s2 / (m * m);
+                        double v_next, k0;
+                        if (psi <= PSI_C) {
+                            double inv = 2.0 / psi;
+                            double b2 = inv - 1.0 + std::sqrt(inv) * std::sqrt(inv - 1.0);
+                            double a  = m / (1.0 + b2);
+                            double root = std::sqrt(b2) + zv[b];
+                            v_next = a * root * root;
+                            k0 = (2.0 * A * a < 1.0)
+                               ? -A * b2 * a / (1.0 - 2.0 * A * a) + 0.5 * std::log(1.0 - 2.0 * A * a)
+                                 - (K1 + 0.5 * K3) * vb
+                               : K0;
+                        } else {
+                            double pz   = (psi - 1.0) / (psi + 1.0);
+                            double beta = (1.0 - pz) / m;
+                            v_next = u[b] <= pz ? 0.0 : std::log((1.0 - pz) / (1.0 - u[b])) / beta;
+                            k0 = (beta > A)
+                               ? -std::log(pz + beta * (1.0 - pz) / (beta - A)) - (K1 + 0.5 * K3) * vb
+                               : K0;
+                        }
+                        x[b] += mu_dt + k0 + K1 * vb + K2 * v_next
+                              + std::sqrt(K3 * vb + K4 * v_next) * zs[b];
+                        v[b] = v_next;
+                        paths[b][s] = std::exp(x[b]);
+                    }
+                }
+                double pv[BLOCK];
+                for (std::size_t b = 0; b < BLOCK; ++b) pv[b] = df * payoff(paths[b]);
+                for (std::size_t b = 0; b < n_indep; ++b) {
+                    double val = cfg_.antithetic ? 0.5 * (pv[b] + pv[b + n_indep]) : pv[b];
+                    sum += val;
+                    sq  += val * val;
+                }
+            }
+            thread_sums[tid].value = sum;
+            thread_sq[tid].value   = sq;
+        };
+
+        run_workers(cfg_.n_threads, cfg_.pin_threads, worker);
+
+        double total_sum = 0, total_sq = 0;
+        for (std::size_t t = 0; t < thread_sums.size(); ++t) {
+            total_sum += thread_sums[t].value;
+            total_sq  += thread_sq[t].value;
+        }
+        uint64_t N = blocks_per_thread * n_indep * cfg_.n_threads;
+
+        double mean = total_sum / N;
+        double var  = (total_sq / N) - mean * mean;
+        double se   = std::sqrt(var / N);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+        return {mean, se, ms};
+    }
+
+private:
+    double S0_, r_, q_;
+    HestonParams p_;
+    double T_;
+    MCConfig cfg_;
+};
+
+// Semi-analytic Heston vanillas:
+//   C = ½(S·e^{-qT} - K·e^{-rT}) + e^{-rT}/π ∫₀^∞ Re[e^{-iu·lnK} (φ(u-i) - K·φ(u)) / (iu)] du
+// with φ the characteristic function of ln S_T in the "little trap" form.
+// The integral uses a fixed Gauss-Legendre rule whose nodes are computed once
+// per process; calls() evaluates φ once per node for a whole strike strip,
+// which is the inner loop of a calibration.
+class HestonAnalytic {
+public:
+    HestonAnalytic(double S0, double r, double q, HestonParams p)
+        : S0_(S0), r_(r), q_(q), p_(p) {}
+
+    [[nodiscard]] double price(OptionType type, double K, double T) const {
+        double c = calls(T, std::span<const double>(&K, 1)).front();
+        if (type == OptionType::Call) return c;
+        return c - S0_ * std::exp(-q_ * T) + K * std::exp(-r_ * T);   // put-call parity
+    }
+
+    [[nodiscard]] std::vector<double> calls(double T, std::span<const double> strikes) const {
+        const auto& quad = quadrature();
+        const std::size_t n = quad.nodes.size();
+        std::vector<std::complex<double>> phi(n), phi_shift(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            phi[i]       = char_fn({quad.nodes[i], 0.0}, T);
+            phi_shift[i] = char_fn({quad.nodes[i], -1.0}, T);
+        }
+        const double df = std::exp(-r_ * T), dfq = std::exp(-q_ * T);
+        std::vector<double> out;
+        out.reserve(strikes.size());
+        for (double K : strikes) {
+            const double k = std::log(K);
+            double integral = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                double u = quad.nodes[i];
+                std::complex<double> e = std::polar(1.0, -u * k);
+                std::complex<double> f = e * (phi_shift[i] - K * phi[i]) / std::complex<double>(0.0, u);
+                integral += quad.weights[i] * f.real();
+            }
+            out.push_back(0.5 * (S0_ * dfq - K * df) + df / math::PI * integral);
+        }
+        return out;
+    }
+
+private:
+    struct Quadrature { std::vector<double> nodes, weights; };
+
+    // Gauss-Legendre on [0, U_MAX], nodes from Newton iteration on P_n
+    static const Quadrature& quadrature() {
+        static const Quadrature quad = [] {
+            constexpr int n = 128;
+            constexpr double U_MAX = 200.0;
+            Quadrature qd;
+            qd.nodes.resize(n);
+            qd.weights.resize(n);
+            for (int i = 0; i < n; ++i) {
+                double x = std::cos(math::PI * (i + 0.75) / (n + 0.5));
+                double dp = 0;
+                for (int it = 0; it < 100; ++it) {
+                    double p0 = 1.0, p1 = x;
+                    for (int k = 2; k <= n; ++k) {
+                        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+                        p0 = p1; p1 = p2;
+                    }
+                    dp = n * (x * p1 - p0) / (x * x - 1.0);
+                    double dx = p1 / dp;
+                    x -= dx;
+                    if (std::fabs(dx) < 1e-15) break;
+                }
+                qd.nodes[i]   = 0.5 * U_MAX * (x + 1.0);
+                qd.weights[i] = U_MAX / ((1.0 - x * x) * dp * dp);
+            }
+            return qd;
+        }();
+        return quad;
+    }
+
+    [[nodiscard]] std::complex<double> char_fn(std::complex<double> u, double T) const {
+        using cd = std::complex<double>;
+        const cd i(0.0, 1.0);
+        const double xi2 = p_.xi * p_.xi;
+        cd beta = p_.kappa - p_.rho * p_.xi * i * u;
+        cd d = std::sqrt(beta * beta + xi2 * (i * u + u * u));
+        cd g = (beta - d) / (beta + d);
+        cd edt = std::exp(-d * T);
+        cd C = (r_ - q_) * i * u * T
+             + p_.kappa * p_.theta / xi2 * ((beta - d) * T - 2.0 * std::log((1.0 - g * edt) / (1.0 - g)));
+        cd D = (beta - d) / xi2 * (1.0 - edt) / (1.0 - g * edt);
+        return std::exp(C + D * p_.v0 + i * u * std::log(S0_));
+    }
+
+    double S0_, r_, q_;
+    HestonParams p_;
+};
+
+// ============================================================================
+// §5e  Multilevel Monte Carlo (Giles)
+// ============================================================================
+struct MLMCConfig {
+    double   rmse          = 0.01;      // target root-mean-square error
+    uint64_t base_steps    = 1;         // time steps on level 0
+    unsigned refinement    = 2;         // M: steps multiply by M per level
+    unsigned max_level     = 12;
+    uint64_t warmup_paths  = 10'000;    // pilot samples on each new level
+    double   weak_order    = 1.0;       // α in the bias extrapolation |E[Y_L]| / (M^α - 1)
+    unsigned n_threads     = std::thread::hardware_concurrency();
+    bool     pin_threads   = false;     // as MCConfig::pin_threads
+};
+
+struct MLMCResult {
+    double                price;
+    double                std_error;
+    double                elapsed_ms;
+    std::vector<uint64_t> paths_per_level;
+    std::vector<double>   level_variance;
+    double                total_steps;     // cost in simulated time steps
+    uint64_t              finest_steps;    // time steps on the finest level
+};
+
+// Level l simulates coupled path pairs: a fine path with base·M^l steps and a
+// coarse path with base·M^(l-1) steps driven by the sums of the same Brownian
+// increments; the estimator is E[P_0] + Σ E[P_l - P_{l-1}]. Per-level sample
+// counts follow N_l ∝ √(V_l / C_l), and levels are added until the
+// extrapolated bias is below rmse/√2, giving about O(ε⁻²) total cost when the
+// level variances decay faster than the cost grows.
+class MultilevelMonteCarlo {
+public:
+    MultilevelMonteCarlo(double S0, double r, double q, double sigma, double T, MLMCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), sigma_(sigma), T_(T), cfg_(cfg) {}
+
+    template <PathPayoff<double> P>
+    MLMCResult run(const P& payoff) const {
+        // Level variances and the bias test need at least two pilot samples
+        if (cfg_.warmup_paths < 2) throw std::invalid_argument("MLMC: warmup_paths must be at least 2");
+        if (cfg_.refinement < 2 || cfg_.base_steps == 0)
+            throw std::invalid_argument("MLMC: need refinement >= 2 and base_steps >= 1");
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        const double M = cfg_.refinement;
+        const double df = std::exp(-r_ * T_);
+        const double eps2 = cfg_.rmse * cfg_.rmse;
+
+        struct Level { math::KahanSum sum, sq; uint64_t n = 0; uint64_t batches = 0; };
+        std::vector<Level> levels(3);
+        std::vector<uint64_t> extra(3, cfg_.warmup_paths);
+
+        auto steps = [&](std::size_t l) {
+            uint64_t n = cfg_.base_steps;
+            for (std::size_t i = 0; i < l; ++i) n *= cfg_.refinement;
+            return n;
+        };
+        auto cost = [&](std::size_t l) { return double(steps(l) + (l ? steps(l - 1) : 0)); };
+        auto variance = [&](const Level& lv) {
+            double mean = lv.sum.value() / lv.n;
+            return std::max(lv.sq.value() / lv.n - mean * mean, 0.0);
+        };
+
+        for (;;) {
+            for (std::size_t l = 0; l < levels.size(); ++l)
+                if (extra[l]) { sample(payoff, l, steps(l), extra[l], df, levels[l]); extra[l] = 0; }
+
+            // Optimal allocation N_l = ⌈2/ε² · √(V_l/C_l) · Σ √(V_k C_k)⌉
+            double sum_vc = 0;
+            for (std::size_t l = 0; l < levels.size(); ++l)
+                sum_vc += std::sqrt(variance(levels[l]) * cost(l));
+            bool more = false;
+            for (std::size_t l = 0; l < levels.size(); ++l) {
+                double n_opt = std::ceil(2.0 / eps2 * std::sqrt(variance(levels[l]) / cost(l)) * sum_vc);
+                if (n_opt > levels[l].n) { extra[l] = static_cast<uint64_t>(n_opt) - levels[l].n; more = true; }
+            }
+            if (more) continue;
+
+            // Bias test on the two finest levels
+            std::size_t L = levels.size() - 1;
+            double yL  = std::fabs(levels[L].sum.value() / levels[L].n);
+            double yL1 = std::fabs(levels[L - 1].sum.value() / levels[L - 1].n) / std::pow(M, cfg_.weak_order);
+            double bias = std::max(yL, yL1) / (std::pow(M, cfg_.weak_order) - 1.0);
+            if (bias * bias <= 0.5 * eps2 || L >= cfg_.max_level) break;
+            levels.emplace_back();
+            extra.push_back(cfg_.warmup_paths);
+        }
+
+        MLMCResult res{};
+        double var_total = 0;
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            res.price += levels[l].sum.value() / levels[l].n;
+            double v = variance(levels[l]);
+            var_total += v / levels[l].n;
+            res.paths_per_level.push_back(levels[l].n);
+            res.level_variance.push_back(v);
+            res.total_steps += levels[l].n * cost(l);
+        }
+        res.std_error = std::sqrt(var_total);
+        res.finest_steps = steps(levels.size() - 1);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        res.elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        return res;
+    }
+
+private:
+    // Adds n samples of Y_l to the level accumulators, split across threads.
+    // Each (level, batch, thread) triple seeds an independent stream.
+    template <typename P, typename Level>
+    void sample(const P& payoff, std::size_t l, uint64_t n_fine, uint64_t n,
+                double df, Level& level) const {
+        const unsigned n_threads = std::max(1u, cfg_.n_threads);
+        const uint64_t M = cfg_.refinement;
+        const double dt = T_ / n_fine;
+        const double drift = (r_ - q_ - 0.5 * sigma_ * sigma_) * dt;
+        const double diffusion = sigma_ * std::sqrt(dt);
+        const uint64_t batch = level.batches++;
+
+        std::vector<CacheAligned<math::KahanSum>> sums(n_threads), sqs(n_threads);
+        auto worker = [&](unsigned tid) {
+            std::seed_seq seq{uint64_t{42}, uint64_t{l}, batch, uint64_t{tid}};
+            std::mt19937_64 rng(seq);
+            std::normal_distribution<double> N(0.0, 1.0);
+            std::vector<double> fine(n_fine + 1), coarse(l ? n_fine / M + 1 : 0);
+            uint64_t count = n / n_threads + (tid < n % n_threads ? 1 : 0);
+
+            for (uint64_t p = 0; p < count; ++p) {
+                double xf = std::log(S0_), xc = xf, inc_sum = 0;
+                fine[0] = S0_;
+                if (l) coarse[0] = S0_;
+                for (uint64_t s = 1; s <= n_fine; ++s) {
+                    double inc = drift + diffusion * N(rng);
+                    xf += inc;
+                    fine[s] = std::exp(xf);
+                    if (l) {
+                        inc_sum += inc;
+                        if (s % M == 0) { xc += inc_sum; inc_sum = 0; coarse[s / M] = std::exp(xc); }
+                    }
+                }
+                double y = df * payoff(fine);
+                if (l) y -= df * payoff(coarse);
+                sums[tid].value.add(y);
+                sqs[tid].value.add(y * y);
+            }
+        };
+        run_workers(n_threads, cfg_.pin_threads, worker);
+
+        for (unsigned t = 0; t < n_threads; ++t) {
+            level.sum.add(sums[t].value.value());
+            level.sq.add(sqs[t].value.value());
+        }
+        level.n += n;
+    }
+
+    double S0_, r_, q_, sigma_, T_;
+    MLMCConfig cfg_;
+};
+
+// ============================================================================
+// §5f  Shared-path portfolio simulation
+// ============================================================================
+// Many payoffs on one underlying priced off a single set of paths. Brownian
+// paths are generated once on the union of every payoff's time grid; each
+// payoff then reads its own grid points, mapped through its own flat vol
+// (S = S0·exp((r - q - σ²/2)t + σW)) or, under local vol, straight from the
+// one simulated spot path. Normals and the time grid are paid for once per
+// underlying rather than once per trade, and all payoffs see common random
+// numbers. Antithetic pairs are exact (negated Brownian increments). As in
+// BasicMonteCarlo, Real is the precision of the spot paths the payoffs see;
+// Brownian paths are always built in double.
+template <typename Real = double>
+class BasicPortfolioMonteCarlo {
+public:
+    BasicPortfolioMonteCarlo(double S0, double r, double q, MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), cfg_(cfg) {}
+
+    BasicPortfolioMonteCarlo(double S0, double r, double q,
+                             std::shared_ptr<const LocalVolSurface> local_vol, MCConfig cfg = {})
+        : S0_(S0), r_(r), q_(q), cfg_(cfg), local_vol_(std::move(local_vol)) {}
+
+    // Registers a payoff observed on n_steps equal steps up to expiry T and
+    // returns its index in run()'s results; sigma is ignored under local vol.
+    std::size_t add(double sigma, double T, uint64_t n_steps, BasicPayoff<Real> payoff) {
+        if (T <= 0.0 || n_steps == 0)
+            throw std::invalid_argument("PortfolioMonteCarlo: expiry and step count must be positive");
+        books_.push_back({sigma, r_, T, n_steps, std::move(payoff), {}});
+        return books_.size() - 1;
+    }
+    std::size_t add(double sigma, double T, BasicPayoff<Real> payoff) {
+        return add(sigma, T, cfg_.n_steps, std::move(payoff));
+    }
+
+    // As add(), with the payoff drifted and discounted at its own rate (its
+    // point on a term structure). Local-vol paths are shared, so there the
+    // rate only sets the discounting.
+    std::size_t add_at_rate(double sigma, double r, double T, uint64_t n_steps, BasicPayoff<Real> payoff) {
+        std::size_t i = add(sigma, T, n_steps, std::move(payoff));
+        books_[i].r = r;
+        return i;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return books_.size(); }
+
+    std::vector<MCResult> run() {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        const std::size_t n_books = books_.size();
+        if (n_books == 0) return {};
+
+        // Union time grid, with each payoff's observation points as indices into it
+        std::vector<double> grid{0.0};
+        for (auto& b : books_)
+            for (uint64_t k = 1; k <= b.n_steps; ++k) grid.push_back(b.T * k / b.n_steps);
+        std::sort(grid.begin(), grid.end());
+        constexpr double TIME_EPS = 1e-12;
+        grid.erase(std::unique(grid.begin(), grid.end(),
+                               [](double a, double b) { return b - a < TIME_EPS; }), grid.end());
+        for (auto& b : books_) {
+            b.index.resize(b.n_steps + 1);
+            for (uint64_t k = 0; k <= b.n_steps; ++k) {
+                double t = b.T * k / b.n_steps;
+                b.index[k] = std::lower_bound(grid.begin(), grid.end(), t - TIME_EPS) - grid.begin();
+            }
+        }
+        const std::size_t m = grid.size() - 1;
+        std::vector<double> sqrt_dt(m + 1, 0.0);
+        for (std::size_t j = 1; j <= m; ++j) sqrt_dt[j] = std::sqrt(grid[j] - grid[j-1]);
+
+        std::vector<LocalVolSurface::Slice> lv_slices;
+        if (local_vol_)
+            for (std::size_t j = 0; j < m; ++j) lv_slices.push_back(local_vol_->slice(grid[j]));
+
+        std::vector<double> df(n_books);
+        for (std::size_t i = 0; i < n_books; ++i) df[i] = std::exp(-books_[i].r * books_[i].T);
+
+        // n_paths counts simulated paths, so antithetic runs draw half as many
+        // independent samples (as in BasicMonteCarlo::run_streaming)
+        uint64_t paths_per_thread = cfg_.n_paths / cfg_.n_threads / (cfg_.antithetic ? 2 : 1);
+        std::vector<CacheAligned<std::vector<math::KahanSum>>> thread_sums(cfg_.n_threads),
+                                                               thread_sq(cfg_.n_threads);
+
+        auto worker = [&](unsigned tid) {
+            std::mt19937_64 rng(42 + tid * 1000);
+            std::normal_distribution<double> N(0.0, 1.0);
+            std::vector<math::KahanSum> sums(n_books), sq(n_books);
+            std::vector<double> z(m + 1), W(m + 1), spot(m + 1), pv(n_books);
+            std::vector<Real> path;
+
+            // One pass over every payoff for the Brownian path sign·W
+            auto evaluate = [&](double sign) {
+                if (local_vol_) {
+                    double x = std::log(S0_);
+                    spot[0] = S0_;
+                    for (std::size_t j = 1; j <= m; ++j) {
+                        double sig = lv_slices[j-1].vol(x);
+                        double dt = grid[j] - grid[j-1];
+                        x += (r_ - q_ - 0.5 * sig * sig) * dt + sig * sqrt_dt[j] * sign * z[j];
+                        spot[j] = std::exp(x);
+                    }
+                }
+                for (std::size_t i = 0; i < n_books; ++i) {
+                    const Book& b = books_[i];
+                    path.resize(b.n_steps + 1);
+                    if (local_vol_) {
+                        for (uint64_t k = 0; k <= b.n_steps; ++k) path[k] = static_cast<Real>(spot[b.index[k]]);
+                    } else {
+                        const double mu = b.r - q_ - 0.5 * b.sigma * b.sigma;
+                        const Real S0 = static_cast<Real>(S0_);
+                        for (uint64_t k = 0; k <= b.n_steps; ++k) {
+                            std::size_t j = b.index[k];
+                            path[k] = S0 * std::exp(static_cast<Real>(mu * grid[j] + b.sigma * sign * W[j]));
+                        }
+                    }
+                    pv[i] = sign > 0 ? df[i] * b.payoff(path)
+                                     : 0.5 * (pv[i] + df[i] * b.payoff(path));
+                }
+            };
+
+            for (uint64_t p = 0; p < paths_per_thread; ++p) {
+                W[0] = 0.0;
+                for (std::size_t j = 1; j <= m; ++j) {
+                    z[j] = N(rng);
+                    W[j] = W[j-1] + sqrt_dt[j] * z[j];
+                }
+                evaluate(1.0);
+                if (cfg_.antithetic) evaluate(-1.0);
+                for (std::size_t i = 0; i < n_books; ++i) {
+                    sums[i].add(pv[i]);
+                    sq[i].add(pv[i] * pv[i]);
+                }
+            }
+            thread_sums[tid].value = std::move(sums);
+            thread_sq[tid].value   = std::move(sq);
+        };
+
+        run_workers(cfg_.n_threads, cfg_.pin_threads, worker);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        const uint64_t N = paths_per_thread * cfg_.n_threads;
+
+        std::vector<MCResult> results;
+        results.reserve(n_books);
+        for (std::size_t i = 0; i < n_books; ++i) {
+            math::KahanSum total_sum, total_sq;
+            for (unsigned t = 0; t < cfg_.n_threads; ++t) {
+                total_sum.add(thread_sums[t].value[i].value());
+                total_sq.add(thread_sq[t].value[i].value());
+            }
+            double mean = total_sum.value() / N;
+            double var  = total_sq.value() / N - mean * mean;
+            results.push_back({mean, std::sqrt(var / N), ms});
+        }
+        return results;
+    }
+
+private:
+    struct Book {
+        double                   sigma;
+        double                   r;
+        double                   T;
+        uint64_t                 n_steps;
+        BasicPayoff<Real>        payoff;
+        std::vector<std::size_t> index;   // observation k → union grid point
+    };
+
+    double S0_, r_, q_;
+    MCConfig cfg_;
+    std::shared_ptr<const LocalVolSurface> local_vol_;
+    std::vector<Book> books_;
+};
+
+using PortfolioMonteCarlo = BasicPortfolioMonteCarlo<double>;
+
+// ============================================================================
+// §6  Trade / Portfolio representation
+// ============================================================================
+struct VanillaOption {
+    OptionType type;
+    double     strike;
+    double     expiry;    // in years
+    double     notional;
+};
+
+struct BarrierOption {
+    OptionType type;
+    double     strike;
+    double     expiry;
+    double     barrier;
+    bool       knock_in;   // true = knock-in, false = knock-out
+    bool       up;         // true = up barrier, false = down
+    double     notional;
+};
+
+struct BermudanOption {
+    OptionType          type;
+    double              strike;
+    double              expiry;
+    std::vector<double> exercise_dates;   // in years; expiry is always exercisable
+    double              notional;
+};
+
+struct AsianOption {
+    OptionType          type;
+    double              strike;
+    double              expiry;
+    std::vector<double> fixings;   // in years, increasing, within [0, expiry]
+    double              notional;
+};
+
+using Trade = std::variant<VanillaOption, BarrierOption, BermudanOption, AsianOption>;
+
+struct MarketData {
+    double      spot;
+    double      rate;       // risk-free, flat; used when no curve is attached
+    double      div_yield;
+    VolSurface  vol_surface;
+    std::shared_ptr<const YieldCurve> curve;
+    double      rate_shift = 0.0;   // parallel shift on top of rate or curve
+
+    // Continuously-compounded rate to maturity T, from the curve if present
+    [[nodiscard]] double rate_to(double T) const {
+        return (curve ? curve->zero_rate(T) : rate) + rate_shift;
+    }
+};
+
+// Numerical method used by price_trade, selected per product type
+enum class PricingMethod { Analytic, MonteCarlo, PDE };
+
+struct PricingConfig {
+    PricingMethod vanilla  = PricingMethod::Analytic;
+    PricingMethod barrier  = PricingMethod::MonteCarlo;
+    PricingMethod bermudan = PricingMethod::MonteCarlo;
+    PricingMethod asian    = PricingMethod::Analytic;   // Turnbull-Wakeman
+    uint64_t      asian_paths = 200'000;                 // Asian MC samples
+    bool          asian_control_variate = true;          // geometric-average CV for Asian MC
+    FDConfig      fd;
+    bool          local_vol = false;       // barrier MC under Dupire local vol
+    bool          barrier_float = false;   // float barrier paths, once check_precision passes
+    bool          importance_sampling = false;  // barrier MC drift-shifted onto the most likely path
+    unsigned      mc_threads = std::thread::hardware_concurrency();  // workers per Monte Carlo run
+};
+
+// Calls f with the streaming kernel for the barrier's (type, direction, knock)
+// combination
+template <typename F>
+decltype(auto) with_barrier_kernel(const BarrierOption& t, F&& f) {
+    return dispatch_bool(t.type == OptionType::Call, [&](auto is_call) {
+        return dispatch_bool(t.up, [&](auto up) {
+            return dispatch_bool(t.knock_in, [&](auto knock_in) {
+                constexpr OptionType type = decltype(is_call)::value ? OptionType::Call : OptionType::Put;
+                using Kernel = BarrierKernel<type, decltype(up)::value, decltype(knock_in)::value>;
+                return f(Kernel{t.strike, t.barrier});
+            });
+        });
+    });
+}
+
+// Monte Carlo for barrier, with paths in the requested precision
+template <typename Real>
+double barrier_mc(const BarrierOption& t, const MarketData& mkt, double sigma, const PricingConfig& pc) {
+    MCConfig cfg;
+    cfg.n_paths = 200'000;
+    cfg.n_threads = std::max(1u, pc.mc_threads);
+    const double r = mkt.rate_to(t.expiry);
+    std::shared_ptr<const LocalVolSurface> lv;
+    if (pc.local_vol)
+        lv = std::make_shared<const LocalVolSurface>(
+            mkt.vol_surface, mkt.spot, r, mkt.div_yield, t.expiry);
+    auto make_mc = [&](const MCConfig& c) {
+        return lv ? BasicMonteCarlo<Real>(mkt.spot, r, mkt.div_yield, lv, t.expiry, c)
+                  : BasicMonteCarlo<Real>(mkt.spot, r, mkt.div_yield, sigma, t.expiry, c);
+    };
+
+    return with_barrier_kernel(t, [&](const auto& kernel) {
+        MCConfig run_cfg = cfg;
+        if (pc.importance_sampling)
+            run_cfg.drift_shift = make_mc(cfg).optimal_drift_shift(kernel);
+        return make_mc(run_cfg).run_streaming(kernel).price;
+    });
+}
+
+// Price a generic trade
+double price_trade(const Trade& trade, const MarketData& mkt, const PricingConfig& pc = {}) {
+    return std::visit([&](auto&& t) -> double {
+        using T = std::decay_t<decltype(t)>;
+
+        if constexpr (std::is_same_v<T, VanillaOption>) {
+            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
+            if (pc.vanilla == PricingMethod::PDE) {
+                FiniteDifference fd(mkt.spot, mkt.rate_to(t.expiry), mkt.div_yield, sigma, pc.fd);
+                return fd.vanilla(t.type, t.strike, t.expiry).price * t.notional;
+            }
+            if (pc.vanilla != PricingMethod::Analytic)
+                throw std::invalid_argument("price_trade: unsupported method for VanillaOption");
+            auto bs = black_scholes(t.type, mkt.spot, t.strike, t.expiry,
+                                    mkt.rate_to(t.expiry), mkt.div_yield, sigma);
+            return bs.price * t.notional;
+
+        } else if constexpr (std::is_same_v<T, BarrierOption>) {
+            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
+            if (pc.barrier == PricingMethod::PDE) {
+                FiniteDifference fd(mkt.spot, mkt.rate_to(t.expiry), mkt.div_yield, sigma, pc.fd);
+                return fd.barrier(t.type, t.strike, t.expiry, t.barrier, t.knock_in, t.up).price
+                       * t.notional;
+            }
+            if (pc.barrier != PricingMethod::MonteCarlo)
+                throw std::invalid_argument("price_trade: unsupported method for BarrierOption");
+            return (pc.barrier_float ? barrier_mc<float>(t, mkt, sigma, pc)
+                                     : barrier_mc<double>(t, mkt, sigma, pc)) * t.notional;
+
+        } else if constexpr (std::is_same_v<T, BermudanOption>) {
+            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
+            if (pc.bermudan == PricingMethod::PDE) {
+                FiniteDifference fd(mkt.spot, mkt.rate_to(t.expiry), mkt.div_yield, sigma, pc.fd);
+                return fd.bermudan(t.type, t.strike, t.expiry, t.exercise_dates).price * t.notional;
+            }
+            if (pc.bermudan != PricingMethod::MonteCarlo)
+                throw std::invalid_argument("price_trade: unsupported method for BermudanOption");
+            // Least-squares MC over the exercise dates only
+            MCConfig cfg;
+            cfg.n_paths = 200'000;
+            cfg.n_threads = std::max(1u, pc.mc_threads);
+            LongstaffSchwartz lsm(mkt.spot, mkt.rate_to(t.expiry), mkt.div_yield, sigma, cfg);
+
+            std::vector<double> dates = t.exercise_dates;
+            dates.push_back(t.expiry);
+            std::erase_if(dates, [&](double d) { return d <= 0.0 || d > t.expiry; });
+            return lsm.run(t.type, t.strike, std::move(dates)).price * t.notional;
+
+        } else if constexpr (std::is_same_v<T, AsianOption>) {
+            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
+            const double r = mkt.rate_to(t.expiry);
+            AsianSchedule sched(t.fixings, r, mkt.div_yield);
+            if (pc.asian == PricingMethod::Analytic)
+                return asian_arithmetic(t.type, mkt.spot, t.strike, t.expiry, sigma, sched)
+                       * t.notional;
+            if (pc.asian != PricingMethod::MonteCarlo)
+                throw std::invalid_argument("price_trade: unsupported method for AsianOption");
+            // Simulated on the fixing schedule; a fixing at 0 is the spot itself.
+            // With the control variate the payoff is arithmetic minus geometric
+            // (β = 1) and the exact geometric price is added back.
+            MCConfig cfg;
+            cfg.n_paths = pc.asian_paths;
+            cfg.n_threads = std::max(1u, pc.mc_threads);
+            cfg.control_variate = pc.asian_control_variate;
+            const bool at_zero = t.fixings.front() == 0.0;
+            std::span<const double> fixings(t.fixings.data() + at_zero, t.fixings.size() - at_zero);
+            const std::size_t first = at_zero ? 0 : 1;
+            const double sign = t.type == OptionType::Call ? 1.0 : -1.0, K = t.strike;
+            const bool cv = cfg.control_variate;
+            auto payoff = [=](const std::vector<double>& path) {
+                double sum = 0.0, log_sum = 0.0;
+                for (std::size_t k = first; k < path.size(); ++k) {
+                    sum += path[k];
+                    if (cv) log_sum += std::log(path[k]);
+                }
+                const double n = static_cast<double>(path.size() - first);
+                double pv = std::max(sign * (sum / n - K), 0.0);
+                if (cv) pv -= std::max(sign * (std::exp(log_sum / n) - K), 0.0);
+                return pv;
+            };
+            double pv = MonteCarlo(mkt.spot, r, mkt.div_yield, sigma, t.expiry, cfg).run(payoff, fixings).price;
+            if (cv) pv += asian_geometric(t.type, mkt.spot, t.strike, t.expiry, sigma, sched);
+            return pv * t.notional;
+        }
+        return 0.0;
+    }, trade);
+}
+
+// Price a book on one market. Monte Carlo barriers are simulated together on
+// shared paths (one PortfolioMonteCarlo per call, float paths under
+// barrier_float as in price_trade) instead of one simulation per trade;
+// everything else, and importance-sampled barriers, whose drift shift is per
+// trade, go through price_trade. Returns PVs in book order.
+std::vector<double> price_book(std::span<const Trade> trades, const MarketData& mkt,
+                               const PricingConfig& pc = {}) {
+    std::vector<double> pvs(trades.size(), 0.0);
+    MCConfig cfg;
+    cfg.n_paths = 200'000;
+    cfg.n_threads = std::max(1u, pc.mc_threads);
+    std::vector<std::size_t> barriers;   // trades for the shared simulation
+
+    for (std::size_t i = 0; i < trades.size(); ++i) {
+        const auto* b = std::get_if<BarrierOption>(&trades[i]);
+        if (!b || pc.barrier != PricingMethod::MonteCarlo || pc.importance_sampling)
+            pvs[i] = price_trade(trades[i], mkt, pc);
+        else
+            barriers.push_back(i);
+    }
+    if (barriers.empty()) return pvs;
+
+    auto simulate = [&]<typename Real>() {
+        double T_max = 0.0;
+        for (std::size_t i : barriers) T_max = std::max(T_max, std::get<BarrierOption>(trades[i]).expiry);
+        const double r = mkt.rate_to(T_max);
+        auto shared = pc.local_vol
+            ? BasicPortfolioMonteCarlo<Real>(mkt.spot, r, mkt.div_yield,
+                                             std::make_shared<const LocalVolSurface>(
+                                                 mkt.vol_surface, mkt.spot, r, mkt.div_yield, T_max),
+                                             cfg)
+            : BasicPortfolioMonteCarlo<Real>(mkt.spot, r, mkt.div_yield, cfg);
+        for (std::size_t i : barriers) {
+            const auto& b = std::get<BarrierOption>(trades[i]);
+            double sigma = mkt.vol_surface.implied_vol(b.expiry, b.strike);
+            with_barrier_kernel(b, [&](auto kernel) {
+                shared.add_at_rate(sigma, mkt.rate_to(b.expiry), b.expiry, cfg.n_steps,
+                                   [kernel](const std::vector<Real>& path) mutable {
+                    kernel.init();
+                    for (std::size_t s = 0; s < path.size(); ++s) kernel.observe(s, path[s]);
+                    return kernel.finish();
+                });
+            });
+        }
+        auto results = shared.run();
+        for (std::size_t k = 0; k < barriers.size(); ++k)
+            pvs[barriers[k]] = results[k].price * std::get<BarrierOption>(trades[barriers[k]]).notional;
+    };
+    if (pc.barrier_float) simulate.template operator()<float>();
+    else                  simulate.template operator()<double>();
+    return pvs;
+}
+
+// ============================================================================
+// §6a  Live market data: tick queue and incremental repricing
+// ============================================================================
+// Bounded multi-producer queue after Vyukov: each cell carries a sequence
+// number that tells producers and the consumer whose turn it is, so push and
+// pop are one CAS on the shared index plus one release store, with no locks.
+// Capacity must be a power of two.
+template <typename T, std::size_t Capacity>
+class MPSCQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+public:
+    MPSCQueue() {
+        for (std::size_t i = 0; i < Capacity; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    // False if the queue is full
+    bool try_push(const T& value) noexcept {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & MASK];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = value;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer: false if the queue is empty
+    bool try_pop(T& out) noexcept {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        Cell& c = cells_[pos & MASK];
+        std::size_t seq = c.seq.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0) return false;
+        out = c.value;
+        c.seq.store(pos + Capacity, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Single consumer: true if there is nothing to pop
+    [[nodiscard]] bool empty() const noexcept {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        std::size_t seq = cells_[pos & MASK].seq.load(std::memory_order_acquire);
+        return static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0;
+    }
+
+private:
+    static constexpr std::size_t MASK = Capacity - 1;
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail_{0};   // producers
+    alignas(CACHE_LINE) std::atomic<std::size_t> head_{0};   // consumer
+    Cell cells_[Capacity];
+};
+
+// One market update for one underlying ("instrument"). Spot ticks carry the
+// new spot; rate ticks the parallel shift of that underlying's starting rate
+// or curve; vol ticks the new vol of surface node `node`.
+struct MarketTick {
+    enum class Field : uint8_t { Spot, Rate, Vol };
+    Field    field;
+    uint32_t instrument;
+    uint32_t node = 0;
+    double   value;
+    std::chrono::steady_clock::time_point stamp = std::chrono::steady_clock::now();
+};
+
+struct LatencyStats {
+    std::size_t batches;
+    std::size_t ticks;
+    double      p50_us;        // tick-to-PV latency of the oldest tick per batch
+    double      p99_us;
+    double      max_us;
+};
+
+// Prices a book against live markets. Producers push() MarketTicks from any
+// thread; one pricing thread drains them in batches, keeps only the latest
+// value per (instrument, field, node), applies them, and reprices just the
+// positions on the instruments that changed, sharing large batches with
+// n_threads - 1 helpers started once in start(). When the queue runs dry the
+// pricing thread spins briefly, then sleeps until the next push(). PVs can be
+// read at any time from other threads. Ticks for unknown instruments or vol
+// nodes are dropped; a trade whose repricing throws keeps its last PV and
+// counts a failure.
+class LivePricer {
+public:
+    static constexpr std::size_t QUEUE_SIZE = 1 << 14;
+    static constexpr std::size_t BATCH      = 1024;
+    using Queue = MPSCQueue<MarketTick, QUEUE_SIZE>;
+
+    // Vanillas analytic, barriers and Bermudans on a coarse PDE grid: MC is
+    // far too slow to sit on the tick path
+    static PricingConfig live_config() {
+        PricingConfig pc;
+        pc.barrier = pc.bermudan = PricingMethod::PDE;
+        pc.fd.n_space = 80;
+        pc.fd.n_time  = 30;
+        return pc;
+    }
+
+    explicit LivePricer(std::vector<MarketData> markets, PricingConfig pc = live_config(),
+                        unsigned n_threads = 1)
+        : base_(markets), markets_(std::move(markets)), pc_(std::move(pc)),
+          n_threads_(std::max(1u, n_threads)), by_instrument_(markets_.size()) {}
+
+    ~LivePricer() { stop(); }
+
+    std::size_t add_position(uint32_t instrument, Trade trade) {
+        if (thread_.joinable()) throw std::logic_error("LivePricer: add positions before start()");
+        if (instrument >= markets_.size()) throw std::out_of_range("LivePricer: unknown instrument");
+        trades_.push_back(std::move(trade));
+        instrument_of_.push_back(instrument);
+        by_instrument_[instrument].push_back(trades_.size() - 1);
+        return trades_.size() - 1;
+    }
+
+    // False if the queue is full. Wakes the pricing thread if it is asleep;
+    // the fences pair with the ones in loop(), so either this sees it parked
+    // or it sees this tick before parking.
+    bool push(const MarketTick& tick) noexcept {
+        if (!queue_->try_push(tick)) return false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) wake();
+        return true;
+    }
+
+    // Starts the helpers, prices the whole book once, then starts the pricing
+    // thread. A trade that fails here reads NaN until a later repricing succeeds.
+    void start() {
+        pvs_ = std::make_unique<std::atomic<double>[]>(trades_.size());
+        failures_ = std::make_unique<std::atomic<std::size_t>[]>(trades_.size());
+        for (std::size_t k = 0; k < trades_.size(); ++k)
+            pvs_[k].store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+        quit_.store(false, std::memory_order_relaxed);
+        for (unsigned t = 1; t < n_threads_; ++t) helpers_.emplace_back([this] { helper(); });
+        std::vector<std::size_t> all(trades_.size());
+        std::iota(all.begin(), all.end(), std::size_t{0});
+        reprice(all);
+        running_.store(true, std::memory_order_release);
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    // Drains what is still queued, then joins the pricing thread and helpers
+    void stop() {
+        if (!thread_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        wake();
+        thread_.join();
+        quit_.store(true, std::memory_order_relaxed);
+        job_.fetch_add(1, std::memory_order_release);
+        job_.notify_all();
+        for (auto& h : helpers_) h.join();
+        helpers_.clear();
+    }
+
+    [[nodiscard]] double pv(std::size_t position) const {
+        return pvs_[position].load(std::memory_order_acquire);
+    }
+    [[nodiscard]] double total_pv() const {
+        double total = 0;
+        for (std::size_t i = 0; i < trades_.size(); ++i) total += pv(i);
+        return total;
+    }
+    // Repricings of this position that threw
+    [[nodiscard]] std::size_t failures(std::size_t position) const {
+        return failures_[position].load(std::memory_order_relaxed);
+    }
+
+    // Ticks dropped for an unknown instrument or vol node; call after stop()
+    [[nodiscard]] std::size_t dropped_ticks() const noexcept { return dropped_; }
+
+    // Call after stop()
+    [[nodiscard]] LatencyStats latency() const {
+        std::vector<double> l = latencies_;
+        if (l.empty()) return {0, ticks_, 0, 0, 0};
+        std::sort(l.begin(), l.end());
+        auto pct = [&](double p) { return l[std::min(l.size() - 1, static_cast<std::size_t>(p * l.size()))]; };
+        return {l.size(), ticks_, pct(0.50), pct(0.99), l.back()};
+    }
+
+private:
+    struct Pending {
+        std::optional<double> spot, rate;
+        std::vector<std::pair<uint32_t, double>> vols;   // (node, vol), latest wins
+        bool dirty = false;
+    };
+
+    void loop() {
+        // Idle this long before sleeping: a tick arriving within it skips the wake-up
+        constexpr auto SPIN = std::chrono::microseconds(50);
+        std::vector<Pending> pending(markets_.size());
+        std::vector<uint32_t> dirty;
+        std::vector<std::size_t> batch;
+        MarketTick tick;
+        auto idle_since = std::chrono::steady_clock::time_point::max();
+        for (;;) {
+            // Read the flag before draining, so nothing pushed before stop() is missed
+            bool live = running_.load(std::memory_order_acquire);
+            std::size_t n = 0;
+            auto oldest = std::chrono::steady_clock::time_point::max();
+            while (n < BATCH && queue_->try_pop(tick)) {
+                ++n;
+                oldest = std::min(oldest, tick.stamp);
+                if (tick.instrument >= pending.size() ||
+                    (tick.field == MarketTick::Field::Vol && !has_node(tick.instrument, tick.node))) {
+                    ++dropped_;
+                    continue;
+                }
+                Pending& p = pending[tick.instrument];
+                if (!p.dirty) { p.dirty = true; dirty.push_back(tick.instrument); }
+                switch (tick.field) {
+                    case MarketTick::Field::Spot: p.spot = tick.value; break;
+                    case MarketTick::Field::Rate: p.rate = tick.value; break;
+                    case MarketTick::Field::Vol: {
+                        auto it = std::find_if(p.vols.begin(), p.vols.end(),
+                                               [&](auto& v) { return v.first == tick.node; });
+                        if (it != p.vols.end()) it->second = tick.value;
+                        else                    p.vols.emplace_back(tick.node, tick.value);
+                        break;
+                    }
+                }
+            }
+            if (n == 0) {
+                if (!live) return;
+                auto now = std::chrono::steady_clock::now();
+                if (idle_since == std::chrono::steady_clock::time_point::max()) idle_since = now;
+                if (now - idle_since < SPIN) { std::this_thread::yield(); continue; }
+                uint32_t gen = wake_.load(std::memory_order_acquire);
+                parked_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (queue_->empty() && running_.load(std::memory_order_acquire))
+                    wake_.wait(gen, std::memory_order_acquire);
+                parked_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            idle_since = std::chrono::steady_clock::time_point::max();
+
+            batch.clear();
+            for (uint32_t i : dirty) {
+                apply(i, pending[i]);
+                pending[i] = Pending{};
+                batch.insert(batch.end(), by_instrument_[i].begin(), by_instrument_[i].end());
+            }
+            dirty.clear();
+            reprice(batch);
+            ticks_ += n;
+            latencies_.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - oldest).count());
+        }
+    }
+
+    // A flat surface has the single node 0
+    bool has_node(uint32_t i, uint32_t node) const {
+        return node < std::max<std::size_t>(1, markets_[i].vol_surface.nodes().size());
+    }
+
+    void apply(uint32_t i, const Pending& p) {
+        MarketData& m = markets_[i];
+        if (p.spot) m.spot = *p.spot;
+        if (p.rate) m.rate_shift = base_[i].rate_shift + *p.rate;
+        for (auto [node, vol] : p.vols)
+            m.vol_surface = m.vol_surface.bumped(node, vol - m.vol_surface.node_vol(node));
+    }
+
+    void wake() {
+        wake_.fetch_add(1, std::memory_order_release);
+        wake_.notify_one();
+    }
+
+    // Reprices the given positions. Small batches stay on the calling thread;
+    // larger ones are published to the helpers, everyone claims BLOCK
+    // positions at a time, and the caller waits for the helpers to finish.
+    void reprice(std::span<const std::size_t> positions) {
+        constexpr std::size_t PER_THREAD = 1024;
+        if (helpers_.empty() || positions.size() < 2 * PER_THREAD) {
+            price(positions);
+            return;
+        }
+        work_ = positions;
+        next_.store(0, std::memory_order_relaxed);
+        busy_.store(static_cast<unsigned>(helpers_.size()), std::memory_order_relaxed);
+        job_.fetch_add(1, std::memory_order_release);
+        job_.notify_all();
+        claim_blocks();
+        for (unsigned b; (b = busy_.load(std::memory_order_acquire)) != 0;)
+            busy_.wait(b, std::memory_order_acquire);
+    }
+
+    void helper() {
+        uint32_t seen = 0;
+        for (;;) {
+            job_.wait(seen, std::memory_order_acquire);
+            seen = job_.load(std::memory_order_acquire);
+            if (quit_.load(std::memory_order_relaxed)) return;
+            claim_blocks();
+            if (busy_.fetch_sub(1, std::memory_order_acq_rel) == 1) busy_.notify_one();
+        }
+    }
+
+    void claim_blocks() {
+        constexpr std::size_t BLOCK = 128;
+        for (;;) {
+            std::size_t lo = next_.fetch_add(BLOCK, std::memory_order_relaxed);
+            if (lo >= work_.size()) return;
+            price(work_.subspan(lo, std::min(BLOCK, work_.size() - lo)));
+        }
+    }
+
+    void price(std::span<const std::size_t> positions) {
+        for (std::size_t k : positions) {
+            try {
+                pvs_[k].store(price_trade(trades_[k], markets_[instrument_of_[k]], pc_),
+                              std::memory_order_release);
+            } catch (...) {
+                failures_[k].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<MarketData> base_, markets_;
+    PricingConfig pc_;
+    unsigned n_threads_;
+    std::vector<Trade> trades_;
+    std::vector<uint32_t> instrument_of_;
+    std::vector<std::vector<std::size_t>> by_instrument_;
+    std::unique_ptr<std::atomic<double>[]> pvs_;
+    std::unique_ptr<std::atomic<std::size_t>[]> failures_;
+    std::unique_ptr<Queue> queue_ = std::make_unique<Queue>();   // 1 MiB of cells, kept off the stack
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    alignas(CACHE_LINE) std::atomic<bool> parked_{false};   // pricing thread asleep on wake_
+    std::atomic<uint32_t> wake_{0};                         // bumped by push() and stop()
+    // Helper pool: job_ is bumped once per published batch (or to quit);
+    // helpers claim blocks of work_ through next_ and count down busy_
+    std::vector<std::thread> helpers_;
+    std::span<const std::size_t> work_;
+    alignas(CACHE_LINE) std::atomic<uint32_t> job_{0};
+    std::atomic<bool> quit_{false};
+    alignas(CACHE_LINE) std::atomic<std::size_t> next_{0};
+    alignas(CACHE_LINE) std::atomic<unsigned> busy_{0};
+    std::vector<double> latencies_;
+    std::size_t ticks_ = 0, dropped_ = 0;
+};
+
+// ============================================================================
+// §6b  Chebyshev pricing proxies
+// ============================================================================
+// Market box a proxy is built over. Spot and vol are mapped to the proxy
+// variables ln(S/K) and total vol σ√T; vol is the trade's implied vol at its
+// strike and expiry, rate the zero rate to expiry.
+struct ProxyDomain {
+    double      spot_lo, spot_hi;
+    double      vol_lo,  vol_hi;
+    double      rate_lo, rate_hi;
+    // Chebyshev nodes per piece and pieces along ln(S/K), σ√T and r
+    std::size_t spot_nodes = 8, spot_pieces = 4;
+    std::size_t vol_nodes  = 8, vol_pieces  = 2;
+    std::size_t rate_nodes = 4, rate_pieces = 1;
+
+    // Spot ±spot_width (relative), vol from σ/vol_factor to σ·vol_factor
+    // around the 1Y ATM vol, rate ±rate_width around the 1Y rate
+    static ProxyDomain around(const MarketData& mkt, double spot_width = 0.3,
+                              double vol_factor = 2.0, double rate_width = 0.02) {
+        double sigma = mkt.vol_surface.implied_vol(1.0, mkt.spot), r = mkt.rate_to(1.0);
+        return {mkt.spot * (1 - spot_width), mkt.spot * (1 + spot_width), sigma / vol_factor,
+                sigma * vol_factor, r - rate_width, r + rate_width};
+    }
+};
+
+// Unit-notional price of one trade as a Chebyshev interpolant in
+// (ln(S/K), σ√T, r), built offline by pricing the trade at the nodes with
+// price_trade. Lookups inside the box cost a few hundred multiply-adds;
+// outside it the proxy falls back to exact pricing. That is about the cost
+// of a closed-form Black-Scholes price, so proxies pay off for trades priced
+// numerically (PDE barriers, Bermudans), not for analytic vanillas; scenario
+// loops that generate (x, v, r) directly should call price_at. Knock-out barriers clip
+// the spot range to the live side of the barrier, where the price is smooth.
+// The pricer should be smooth in its inputs: PDE rather than Monte Carlo for
+// path-dependent trades, or the interpolant fits the noise.
+class TradeProxy {
+public:
+    TradeProxy(Trade trade, const MarketData& base, ProxyDomain dom, PricingConfig pc = {},
+               unsigned n_threads = 4)
+        : trade_(std::move(trade)), div_yield_(base.div_yield), pc_(std::move(pc)),
+          table_(build(dom, n_threads))
+    {
+        // Check the interpolant off the nodes, on a uniform (x, v) grid at the
+        // rate ends, and keep the worst error alongside the table's estimate
+        const auto& ax = table_.axes();
+        const std::size_t nx = ax[0].points() / 2, nv = ax[1].points() / 2;
+        for (std::size_t i = 0; i < nx; ++i)
+            for (std::size_t j = 0; j < nv; ++j)
+                for (double z : {ax[2].lo, ax[2].hi}) {
+                    double x = ax[0].lo + (i + 0.37) / nx * (ax[0].hi - ax[0].lo);
+                    double v = ax[1].lo + (j + 0.37) / nv * (ax[1].hi - ax[1].lo);
+                    validated_error_ = std::max(validated_error_, std::fabs(table_(x, v, z) - exact(x, v, z)));
+                }
+    }
+
+    [[nodiscard]] double price(const MarketData& mkt) const {
+        double x = std::log(mkt.spot / strike_);
+        double v = mkt.vol_surface.implied_vol(T_, strike_) * std::sqrt(T_);
+        double r = mkt.rate_to(T_);
+        if (!table_.contains(x, v, r)) return price_trade(trade_, mkt, pc_);
+        return notional_ * table_(x, v, r);
+    }
+
+    // Same, from spot, vol and rate directly (no vol-surface lookup)
+    [[nodiscard]] double price(double spot, double sigma, double rate) const {
+        return price_at(std::log(spot / strike_), sigma * sqrt_T_, rate);
+    }
+
+    // Same, from the proxy variables x = ln(S/K), v = σ√T and r
+    [[nodiscard]] double price_at(double x, double v, double r) const {
+        if (!table_.contains(x, v, r)) return notional_ * exact(x, v, r);
+        return notional_ * table_(x, v, r);
+    }
+
+    // Error bound per unit notional: the larger of the table's own estimate
+    // and the worst error measured off the nodes at build time
+    [[nodiscard]] double error_bound() const noexcept {
+        return std::max(table_.error_estimate(), validated_error_);
+    }
+    [[nodiscard]] std::size_t bytes() const noexcept { return table_.bytes(); }
+    [[nodiscard]] const math::Chebyshev3D& table() const noexcept { return table_; }
+
+private:
+    [[nodiscard]] double exact(double x, double v, double r) const {
+        MarketData m{strike_ * std::exp(x), r, div_yield_, VolSurface(v / sqrt_T_), nullptr};
+        return price_trade(unit_, m, pc_);
+    }
+
+    math::Chebyshev3D build(const ProxyDomain& dom, unsigned n_threads) {
+        std::visit([&](const auto& t) { strike_ = t.strike; T_ = t.expiry; notional_ = t.notional; }, trade_);
+        sqrt_T_ = std::sqrt(T_);
+        unit_ = trade_;
+        std::visit([](auto& t) { t.notional = 1.0; }, unit_);
+
+        double x_lo = std::log(dom.spot_lo / strike_), x_hi = std::log(dom.spot_hi / strike_);
+        if (auto* b = std::get_if<BarrierOption>(&trade_); b && !b->knock_in) {
+            double xb = std::log(b->barrier / strike_);
+            if (b->up) x_hi = std::min(x_hi, xb);
+            else       x_lo = std::max(x_lo, xb);
+            if (!(x_hi > x_lo)) throw std::invalid_argument("TradeProxy: spot range is knocked out");
+        }
+        std::array<math::Chebyshev3D::Axis, 3> axes{{
+            {x_lo, x_hi, dom.spot_nodes, dom.spot_pieces},
+            {dom.vol_lo * std::sqrt(T_), dom.vol_hi * std::sqrt(T_), dom.vol_nodes, dom.vol_pieces},
+            {dom.rate_lo, dom.rate_hi, dom.rate_nodes, dom.rate_pieces},
+        }};
+        const std::size_t ny = axes[1].points(), nz = axes[2].points();
+        std::vector<double> values(axes[0].points() * ny * nz);
+        const unsigned n = std::max(1u, std::min<unsigned>(n_threads, values.size()));
+        run_workers(n, false, [&](unsigned tid) {
+            for (std::size_t idx = tid; idx < values.size(); idx += n) {
+                std::size_t k = idx % nz, j = idx / nz % ny, i = idx / (ny * nz);
+                values[idx] = exact(math::Chebyshev3D::node(axes[0], i), math::Chebyshev3D::node(axes[1], j),
+                                    math::Chebyshev3D::node(axes[2], k));
+            }
+        });
+        return math::Chebyshev3D(axes, values);
+    }
+
+    Trade         trade_, unit_;
+    double        div_yield_;
+    PricingConfig pc_;
+    double        strike_ = 0, T_ = 0, sqrt_T_ = 0, notional_ = 0;
+    math::Chebyshev3D   table_;
+    double        validated_error_ = 0;
+};
+
+// ============================================================================
+// §6c  Market data snapshots (epoch-based hot swap)
+// ============================================================================
+// Atomically swappable, immutable MarketData. Readers pin the current epoch
+// in a per-reader slot and then load the snapshot pointer; they never wait
+// and never see a half-written market. A writer swaps in a new snapshot,
+// advances the epoch, and retires the old one tagged with that epoch. A
+// retired snapshot is freed once every active reader has pinned an epoch at
+// or past its tag, since such a reader loaded the pointer after the swap.
+// All epoch and slot operations are sequentially consistent, which is what
+// makes the "loaded after the swap" argument hold. Writers serialise on a
+// mutex that readers never touch.
+class MarketStore {
+    struct Node;
+public:
+    // Read access to one snapshot; holds its reader slot until destroyed
+    class Snapshot {
+    public:
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot(Snapshot&& o) noexcept : slot_(std::exchange(o.slot_, nullptr)), node_(o.node_) {}
+        ~Snapshot() { if (slot_) slot_->store(IDLE, std::memory_order_release); }
+
+        [[nodiscard]] const MarketData& operator*() const noexcept { return node_->market; }
+        [[nodiscard]] const MarketData* operator->() const noexcept { return &node_->market; }
+        [[nodiscard]] uint64_t version() const noexcept { return node_->version; }
+
+    private:
+        friend class MarketStore;
+        Snapshot(std::atomic<uint64_t>* slot, const Node* node) : slot_(slot), node_(node) {}
+        std::atomic<uint64_t>* slot_;
+        const Node*            node_;
+    };
+
+    explicit MarketStore(MarketData initial, std::size_t max_readers = 64)
+        : slots_(std::max<std::size_t>(1, max_readers)),
+          current_(new Node{std::move(initial), 0})
+    {
+        for (auto& s : slots_) s.value.store(IDLE, std::memory_order_relaxed);
+    }
+
+    MarketStore(const MarketStore&) = delete;
+    MarketStore& operator=(const MarketStore&) = delete;
+
+    // Readers must have released their snapshots
+    ~MarketStore() {
+        delete current_.load();
+        for (auto& r : retired_) delete r.node;
+    }
+
+    // Pins the current snapshot. Wait-free unless more than max_readers
+    // snapshots are held at once, in which case it spins for a free slot.
+    [[nodiscard]] Snapshot read() const {
+        const std::size_t n = slots_.size();
+        std::size_t i = std::hash<std::thread::id>{}(std::this_thread::get_id()) % n;
+        for (;; i = (i + 1) % n) {
+            uint64_t idle = IDLE;
+            if (slots_[i].value.load(std::memory_order_relaxed) == IDLE
+                && slots_[i].value.compare_exchange_strong(idle, epoch_.load()))
+                return Snapshot(&slots_[i].value, current_.load());
+        }
+    }
+
+    // Publishes next as the current market and reclaims what no reader holds
+    uint64_t publish(MarketData next) {
+        std::lock_guard lock(writer_);
+        return swap_in(std::move(next));
+    }
+
+    // Copy-modify-publish: f edits a copy of the current market
+    template <std::invocable<MarketData&> F>
+    uint64_t update(F&& f) {
+        std::lock_guard lock(writer_);
+        MarketData next = current_.load()->market;
+        std::forward<F>(f)(next);
+        return swap_in(std::move(next));
+    }
+
+    // Frees retired snapshots no reader holds any more; returns how many
+    // are still pinned
+    std::size_t collect() {
+        std::lock_guard lock(writer_);
+        reclaim();
+        return retired_.size();
     }
-    res.gamma = dfq * nd1 / (S * sigma * sqrt_T);
-    res.vega  = S * dfq * nd1 * sqrt_T / 100.0;
-    res.theta = (-(S * dfq * nd1 * sigma) / (2.0 * sqrt_T)
-                 - r * K * df * (type == OptionType::Call ? Nd2 : -math::norm_cdf(-d2))
-                 + q * S * dfq * (type == OptionType::Call ? Nd1 : -math::norm_cdf(-d1))) / 365.0;
-    return res;
-}
+    [[nodiscard]] uint64_t reclaimed() const noexcept { return reclaimed_.load(std::memory_order_relaxed); }
 
-// Implied vol via Brent on BS price
-double implied_vol(OptionType type, double mkt_price, double S, double K,
-                   double T, double r, double q) {
-    auto f = [&](double sig) {
-        return black_scholes(type, S, K, T, r, q, sig).price - mkt_price;
+private:
+    static constexpr uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+
+    struct Node {
+        MarketData market;
+        uint64_t   version;
     };
-    return math::brent(f, 1e-4, 5.0);
-}
+    struct Retired {
+        const Node* node;
+        uint64_t    epoch;      // readers at this epoch or later cannot hold it
+    };
+
+    uint64_t swap_in(MarketData next) {
+        const Node* old = current_.load();
+        const uint64_t version = old->version + 1;
+        current_.store(new Node{std::move(next), version});
+        retired_.push_back({old, epoch_.fetch_add(1) + 1});
+        reclaim();
+        return version;
+    }
+
+    void reclaim() {
+        uint64_t oldest = IDLE;
+        for (auto& s : slots_) oldest = std::min(oldest, s.value.load());
+        std::erase_if(retired_, [&](const Retired& r) {
+            if (r.epoch > oldest) return false;
+            delete r.node;
+            reclaimed_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        });
+    }
+
+    mutable std::vector<CacheAligned<std::atomic<uint64_t>>> slots_;   // pinned epoch or IDLE
+    std::atomic<const Node*> current_;
+    std::atomic<uint64_t>    epoch_{0};
+    mutable std::mutex       writer_;
+    std::vector<Retired>     retired_;
+    std::atomic<uint64_t>    reclaimed_{0};
+};
 
 // ============================================================================
-// §5  Monte Carlo Engine (multi-threaded, variance reduction)
+// §7  Risk: Delta-Normal VaR & Scenario VaR
 // ============================================================================
-struct MCConfig {
-    uint64_t n_paths      = 500'000;
-    uint64_t n_steps      = 252;
-    bool     antithetic    = true;
-    bool     control_variate = true;   // use geometric-average as CV for Asian
-    unsigned n_threads     = std::thread::hardware_concurrency();
+struct RiskResult {
+    double portfolio_value;
+    double delta_normal_var_95;
+    double delta_normal_var_99;
+    double component_var_95;            // worst single-name
+    std::string worst_name;
 };
 
-struct MCResult {
-    double price;
-    double std_error;
-    double elapsed_ms;
+// ----------------------------------------------------------------------------
+// Multi-factor delta-gamma VaR
+// ----------------------------------------------------------------------------
+// Factors are the spot (relative move), every implied-vol node (absolute vol
+// move) and the rate (absolute move). Position sensitivities come from
+// central bump & reprice of the whole book per factor; the P&L over the
+// horizon is approximated as δᵀx + ½ Σ γ_i x_i² with x ~ N(0, Σ), whose mean
+// and variance are
+//   E = ½ Σ γ_i Σ_ii,   V = δᵀΣδ + ½ Σ_ij γ_i γ_j Σ_ij²
+// and VaR_α = z_α √V - E.
+// Rate is a parallel shift, for markets without a curve; Pillar moves one
+// pillar of the market's curve
+enum class FactorKind { Spot, Vol, Rate, Pillar };
+
+struct RiskFactor {
+    FactorKind  kind;
+    std::size_t index;      // vol node or curve pillar; unused for spot and rate
+    std::string name;
 };
 
-// Payoff function signature: (path of spot prices) -> payoff
-using Payoff = std::function<double(const std::vector<double>&)>;
+std::vector<RiskFactor> risk_factors(const MarketData& mkt) {
+    std::vector<RiskFactor> f{{FactorKind::Spot, 0, "spot"}};
+    if (mkt.vol_surface.is_flat()) {
+        f.push_back({FactorKind::Vol, 0, "vol"});
+    } else {
+        const auto& nodes = mkt.vol_surface.nodes();
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            std::ostringstream name;
+            name << "vol " << nodes[i].T << "y/" << nodes[i].K;
+            f.push_back({FactorKind::Vol, i, name.str()});
+        }
+    }
+    if (mkt.curve && !mkt.curve->pillars().empty()) {
+        const auto& pillars = mkt.curve->pillars();
+        for (std::size_t k = 0; k < pillars.size(); ++k) {
+            std::ostringstream name;
+            name << "rate " << pillars[k].first << "y";
+            f.push_back({FactorKind::Pillar, k, name.str()});
+        }
+    } else {
+        f.push_back({FactorKind::Rate, 0, "rate"});
+    }
+    return f;
+}
 
-class MonteCarlo {
-public:
-    MonteCarlo(double S0, double r, double q, double sigma, double T,
-               MCConfig cfg = {})
-        : S0_(S0), r_(r), q_(q), sigma_(sigma), T_(T), cfg_(cfg) {}
+// Bump size in the factor's own units: 1% of spot, one vol point, 1bp
+double factor_bump(const RiskFactor& f) {
+    switch (f.kind) {
+        case FactorKind::Spot: return 0.01;
+        case FactorKind::Vol:  return 0.01;
+        case FactorKind::Rate:
+        case FactorKind::Pillar: return 1e-4;
+    }
+    return 0.0;
+}
 
-    MCResult run(const Payoff& payoff) const {
-        auto t0 = std::chrono::high_resolution_clock::now();
+MarketData shift_factor(const MarketData& mkt, const RiskFactor& f, double h) {
+    MarketData out = mkt;
+    switch (f.kind) {
+        case FactorKind::Spot: out.spot *= 1.0 + h; break;
+        case FactorKind::Vol:  out.vol_surface = mkt.vol_surface.bumped(f.index, h); break;
+        case FactorKind::Rate: out.rate_shift += h; break;
+        case FactorKind::Pillar:
+            if (!mkt.curve) throw std::invalid_argument("shift_factor: market has no yield curve");
+            out.curve = std::make_shared<const YieldCurve>(mkt.curve->bumped_pillar(f.index, h));
+            break;
+    }
+    return out;
+}
 
-        double dt = T_ / cfg_.n_steps;
-        double drift = (r_ - q_ - 0.5 * sigma_ * sigma_) * dt;
-        double diffusion = sigma_ * std::sqrt(dt);
-        double df = std::exp(-r_ * T_);
+// Daily factor covariance, row-major n × n
+struct FactorCovariance {
+    std::vector<RiskFactor> factors;
+    std::vector<double>     cov;
 
-        uint64_t paths_per_thread = cfg_.n_paths / cfg_.n_threads;
-        std::vector<double> thread_sums(cfg_.n_threads, 0.0);
-        std::vector<double> thread_sq(cfg_.n_threads, 0.0);
+    [[nodiscard]] std::size_t size() const noexcept { return factors.size(); }
 
-        auto worker = [&](unsigned tid) {
-            std::mt19937_64 rng(42 + tid * 1000);
-            std::normal_distribution<double> N(0.0, 1.0);
-            double sum = 0, sq = 0;
-            std::vector<double> path(cfg_.n_steps + 1);
+    // Sample covariance of a history of daily factor moves, returns[obs][factor].
+    // The history is transposed to factor-major and Σ_ij computed as tiled dot
+    // products of demeaned columns, lower-triangle tiles split across threads.
+    static FactorCovariance from_returns(std::vector<RiskFactor> factors,
+                                         std::span<const double> returns,
+                                         unsigned n_threads = std::thread::hardware_concurrency()) {
+        const std::size_t n = factors.size();
+        const std::size_t T = returns.size() / n;
+        if (n == 0 || T < 2 || returns.size() != T * n)
+            throw std::invalid_argument("FactorCovariance: returns must be obs × factors with obs ≥ 2");
 
-            for (uint64_t p = 0; p < paths_per_thread; ++p) {
-                // Generate path
-                path[0] = S0_;
-                for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
-                    double z = N(rng);
-                    path[s] = path[s-1] * std::exp(drift + diffusion * z);
-                }
-                double pv = df * payoff(path);
+        std::vector<double> X(n * T);                  // [factor][obs], demeaned
+        for (std::size_t i = 0; i < n; ++i) {
+            double mean = 0;
+            for (std::size_t t = 0; t < T; ++t) mean += returns[t * n + i];
+            mean /= T;
+            for (std::size_t t = 0; t < T; ++t) X[i * T + t] = returns[t * n + i] - mean;
+        }
 
-                if (cfg_.antithetic) {
-                    // Antithetic path (reuse same z's negated — approximate via re-sim)
-                    path[0] = S0_;
-                    for (uint64_t s = 1; s <= cfg_.n_steps; ++s) {
-                        double z = N(rng);  // independent for simplicity
-                        path[s] = path[s-1] * std::exp(drift - diffusion * z);
+        constexpr std::size_t TILE = 32;
+        FactorCovariance out{std::move(factors), std::vector<double>(n * n)};
+        parallel_blocks(n, TILE, n_threads, [&](std::size_t i0, std::size_t i1, unsigned) {
+            for (std::size_t j0 = 0; j0 < i1; j0 += TILE) {
+                std::size_t j1 = std::min(j0 + TILE, n);
+                for (std::size_t i = i0; i < i1; ++i) {
+                    const double* xi = &X[i * T];
+                    for (std::size_t j = j0; j < std::min(j1, i + 1); ++j) {
+                        const double* xj = &X[j * T];
+                        double s = 0;
+                        for (std::size_t t = 0; t < T; ++t) s += xi[t] * xj[t];
+                        out.cov[i * n + j] = out.cov[j * n + i] = s / (T - 1);
                     }
-                    double pv2 = df * payoff(path);
-                    pv = 0.5 * (pv + pv2);
                 }
-
-                sum += pv;
-                sq  += pv * pv;
             }
-            thread_sums[tid] = sum;
-            thread_sq[tid]   = sq;
-        };
+        });
+        return out;
+    }
+};
 
-        std::vector<std::thread> threads;
-        for (unsigned t = 0; t < cfg_.n_threads; ++t)
-            threads.emplace_back(worker, t);
-        for (auto& th : threads) th.join();
+struct FactorVaRResult {
+    double              portfolio_value;
+    double              var_95;
+    double              var_99;
+    double              expected_pnl;        // gamma drift ½ Σ γ_i Σ_ii
+    double              component_var_95;    // largest Euler contribution
+    std::string         worst_name;
+    std::vector<double> factor_delta;        // book P&L per unit factor move
+    std::vector<double> factor_gamma;
+    double              elapsed_ms;
+};
 
-        double total_sum = std::accumulate(thread_sums.begin(), thread_sums.end(), 0.0);
-        double total_sq  = std::accumulate(thread_sq.begin(), thread_sq.end(), 0.0);
-        uint64_t N = paths_per_thread * cfg_.n_threads;
+// Delta-gamma VaR of a book over the given factors. Each factor's up and
+// down books are repriced together (factors split across threads, each
+// repricing's Monte Carlo getting an even share of n_threads) and folded
+// straight into the book delta and gamma, so memory stays at a few
+// book-length PV vectors whatever the factor count. Σδ is a blocked parallel
+// matrix-vector product. A position's Euler contribution z·D_p·Σδ / √V is
+// its derivative along y = Σδ, taken from one more pair of books with every
+// factor moved along y at once.
+FactorVaRResult factor_var(std::span<const std::pair<std::string, Trade>> positions,
+                           const MarketData& mkt, const FactorCovariance& fc,
+                           double horizon_days = 10, const PricingConfig& pc = {},
+                           unsigned n_threads = std::thread::hardware_concurrency()) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const std::size_t n_pos = positions.size(), n = fc.size();
+    n_threads = std::max(1u, n_threads);
+    if (n_pos == 0) throw std::invalid_argument("factor_var: empty book");
 
-        double mean = total_sum / N;
-        double var  = (total_sq / N) - mean * mean;
-        double se   = std::sqrt(var / N);
+    std::vector<Trade> trades;
+    trades.reserve(n_pos);
+    for (auto& pos : positions) trades.push_back(pos.second);
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    // Base book first, then per factor the up and down books differenced
+    // position by position. Every book uses the same Monte Carlo thread
+    // count, so MC trades difference against common random numbers.
+    PricingConfig scen_pc = pc;
+    scen_pc.mc_threads = std::max<unsigned>(1, n_threads / std::min<std::size_t>(n_threads, std::max<std::size_t>(n, 1)));
+    const std::vector<double> base = price_book(trades, mkt, scen_pc);
+    std::vector<double> delta(n), gamma(n);
+    parallel_blocks(n, 1, n_threads, [&](std::size_t f, std::size_t, unsigned) {
+        const double h = factor_bump(fc.factors[f]);
+        const auto up = price_book(trades, shift_factor(mkt, fc.factors[f], h), scen_pc);
+        const auto dn = price_book(trades, shift_factor(mkt, fc.factors[f], -h), scen_pc);
+        math::KahanSum d, g;
+        for (std::size_t p = 0; p < n_pos; ++p) {
+            d.add(up[p] - dn[p]);
+            g.add(up[p] - 2.0 * base[p] + dn[p]);
+        }
+        delta[f] = d.value() / (2.0 * h);
+        gamma[f] = g.value() / (h * h);
+    });
 
-        return {mean, se, ms};
+    // y = Σ_h δ and the gamma terms, row blocks in parallel
+    const double h_scale = horizon_days;
+    std::vector<double> y(n);
+    std::vector<CacheAligned<double>> part_mean(n_threads), part_gg(n_threads);
+    parallel_blocks(n, 64, n_threads, [&](std::size_t lo, std::size_t hi, unsigned tid) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            const double* row = &fc.cov[i * n];
+            double acc = 0, gg = 0;
+            for (std::size_t j = 0; j < n; ++j) {
+                acc += row[j] * delta[j];
+                gg  += gamma[j] * row[j] * row[j];
+            }
+            y[i] = h_scale * acc;
+            part_gg[tid].value += gamma[i] * gg * h_scale * h_scale;
+            part_mean[tid].value += 0.5 * gamma[i] * row[i] * h_scale;
+        }
+    });
+    double var_delta = std::inner_product(delta.begin(), delta.end(), y.begin(), 0.0);
+    double mean = 0, var_gamma = 0;
+    for (unsigned t = 0; t < n_threads; ++t) { mean += part_mean[t].value; var_gamma += 0.5 * part_gg[t].value; }
+    double sd = std::sqrt(std::max(var_delta + var_gamma, 0.0));
+
+    // Euler contributions of each position to the delta part: D_p·y as a
+    // central difference along y, scaled so no factor moves further than its
+    // own bump
+    std::vector<double> contrib(n_pos, 0.0);
+    double scale = 0.0;
+    for (std::size_t f = 0; f < n; ++f) scale = std::max(scale, std::fabs(y[f]) / factor_bump(fc.factors[f]));
+    if (sd > 0 && scale > 0) {
+        const double eps = 1.0 / scale;
+        PricingConfig dir_pc = pc;
+        dir_pc.mc_threads = std::max(1u, n_threads / 2);
+        std::vector<double> along[2];
+        parallel_blocks(2, 1, n_threads, [&](std::size_t s, std::size_t, unsigned) {
+            const double sign = s ? -1.0 : 1.0;
+            MarketData m = mkt;
+            for (std::size_t f = 0; f < n; ++f)
+                if (y[f] != 0.0) m = shift_factor(m, fc.factors[f], sign * eps * y[f]);
+            along[s] = price_book(trades, m, dir_pc);
+        });
+        for (std::size_t p = 0; p < n_pos; ++p)
+            contrib[p] = 1.645 * (along[0][p] - along[1][p]) / (2.0 * eps) / sd;
     }
+    auto worst = std::max_element(contrib.begin(), contrib.end());
 
-private:
-    double S0_, r_, q_, sigma_, T_;
-    MCConfig cfg_;
-};
+    FactorVaRResult res;
+    res.portfolio_value  = std::accumulate(base.begin(), base.end(), 0.0);
+    res.var_95           = 1.645 * sd - mean;
+    res.var_99           = 2.326 * sd - mean;
+    res.expected_pnl     = mean;
+    res.component_var_95 = *worst;
+    res.worst_name       = positions[worst - contrib.begin()].first;
+    res.factor_delta     = std::move(delta);
+    res.factor_gamma     = std::move(gamma);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    res.elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    return res;
+}
 
-// ============================================================================
-// §6  Trade / Portfolio representation
-// ============================================================================
-struct VanillaOption {
-    OptionType type;
-    double     strike;
-    double     expiry;    // in years
-    double     notional;
+// ----------------------------------------------------------------------------
+// Key-rate DV01 ladder
+// ----------------------------------------------------------------------------
+struct KeyRateResult {
+    std::vector<double>      maturities;      // swap pillars
+    std::vector<double>      dv01;            // book PV change per +1bp on each pillar
+    std::vector<std::size_t> repriced;        // trades repriced for each bucket
+    double                   total_dv01;      // sum over buckets
+    double                   elapsed_ms;
 };
 
-struct BarrierOption {
-    OptionType type;
-    double     strike;
-    double     expiry;
-    double     barrier;
-    bool       knock_in;   // true = knock-in, false = knock-out
-    bool       up;         // true = up barrier, false = down
-    double     notional;
-};
+// Bumps each swap pillar of mkt.curve by 1bp in turn. A bump only
+// rebootstraps the curve from that pillar on, and trades price off the zero
+// rate to their expiry, so a trade is repriced only if that rate moved;
+// every other trade keeps its base PV. Buckets run in parallel, each
+// repricing's Monte Carlo getting an even share of n_threads; the base book
+// uses the same share so bumped and base runs draw the same random numbers.
+KeyRateResult key_rate_dv01(std::span<const Trade> trades, const MarketData& mkt,
+                            const PricingConfig& pc = {},
+                            unsigned n_threads = std::thread::hardware_concurrency()) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (!mkt.curve) throw std::invalid_argument("key_rate_dv01: market has no yield curve");
+    constexpr double BP = 1e-4;
 
-using Trade = std::variant<VanillaOption, BarrierOption>;
+    const auto& pillars = mkt.curve->pillars();
+    const std::size_t n = pillars.size();
+    std::vector<double> expiry(trades.size());
+    for (std::size_t i = 0; i < trades.size(); ++i)
+        expiry[i] = std::visit([](const auto& t) { return t.expiry; }, trades[i]);
+    PricingConfig bucket_pc = pc;
+    n_threads = std::max(1u, n_threads);
+    bucket_pc.mc_threads = std::max<unsigned>(1, n_threads / std::min<std::size_t>(n_threads, std::max<std::size_t>(n, 1)));
+    const std::vector<double> base = price_book(trades, mkt, bucket_pc);
 
-struct MarketData {
-    double      spot;
-    double      rate;       // risk-free
-    double      div_yield;
-    VolSurface  vol_surface;
-};
+    KeyRateResult res{{}, std::vector<double>(n), std::vector<std::size_t>(n), 0.0, 0.0};
+    for (auto& p : pillars) res.maturities.push_back(p.first);
 
-// Price a generic trade
-double price_trade(const Trade& trade, const MarketData& mkt) {
-    return std::visit([&](auto&& t) -> double {
-        using T = std::decay_t<decltype(t)>;
+    parallel_blocks(n, 1, n_threads, [&](std::size_t k, std::size_t, unsigned) {
+        MarketData bumped = mkt;
+        bumped.curve = std::make_shared<const YieldCurve>(mkt.curve->bumped_pillar(k, BP));
 
-        if constexpr (std::is_same_v<T, VanillaOption>) {
-            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
-            auto bs = black_scholes(t.type, mkt.spot, t.strike, t.expiry,
-                                    mkt.rate, mkt.div_yield, sigma);
-            return bs.price * t.notional;
+        std::vector<Trade> hit;
+        std::vector<std::size_t> idx;
+        for (std::size_t i = 0; i < trades.size(); ++i)
+            if (bumped.rate_to(expiry[i]) != mkt.rate_to(expiry[i])) {
+                hit.push_back(trades[i]);
+                idx.push_back(i);
+            }
+        auto pv = price_book(hit, bumped, bucket_pc);
+        double dv01 = 0.0;
+        for (std::size_t j = 0; j < idx.size(); ++j) dv01 += pv[j] - base[idx[j]];
+        res.dv01[k] = dv01;
+        res.repriced[k] = idx.size();
+    });
 
-        } else if constexpr (std::is_same_v<T, BarrierOption>) {
-            double sigma = mkt.vol_surface.implied_vol(t.expiry, t.strike);
-            // Monte Carlo for barrier
-            MCConfig cfg;
-            cfg.n_paths = 200'000;
-            MonteCarlo mc(mkt.spot, mkt.rate, mkt.div_yield, sigma, t.expiry, cfg);
-
-            auto payoff = [&](const std::vector<double>& path) -> double {
-                bool triggered = false;
-                for (auto& s : path) {
-                    if (t.up && s >= t.barrier)  triggered = true;
-                    if (!t.up && s <= t.barrier) triggered = true;
-                }
-                bool alive = t.knock_in ? triggered : !triggered;
-                if (!alive) return 0.0;
-                double ST = path.back();
-                if (t.type == OptionType::Call) return std::max(ST - t.strike, 0.0);
-                else                           return std::max(t.strike - ST, 0.0);
-            };
-            return mc.run(payoff).price * t.notional;
-        }
-        return 0.0;
-    }, trade);
+    res.total_dv01 = std::accumulate(res.dv01.begin(), res.dv01.end(), 0.0);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    res.elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    return res;
 }
 
-// ============================================================================
-// §7  Risk: Delta-Normal VaR & Scenario VaR
-// ============================================================================
-struct RiskResult {
-    double portfolio_value;
-    double delta_normal_var_95;
-    double delta_normal_var_99;
-    double component_var_95;            // worst single-name
-    std::string worst_name;
-};
-
 class RiskEngine {
 public:
     void add_position(std::string name, Trade trade) {
@@ -449,18 +4891,22 @@ public:
         struct PosRisk { std::string name; double pv; double delta_dollar; };
         std::vector<PosRisk> risks;
 
-        for (auto& [name, trade] : positions_) {
-            double pv = price_trade(trade, mkt);
-            total_pv += pv;
+        // Whole book at once (shared MC paths), then bump & reprice for delta
+        std::vector<Trade> trades;
+        trades.reserve(positions_.size());
+        for (auto& pos : positions_) trades.push_back(pos.second);
+        MarketData bumped = mkt;
+        bumped.spot = mkt.spot * 1.01;
+        auto pvs    = price_book(trades, mkt);
+        auto pvs_up = price_book(trades, bumped);
 
-            // Bump & reprice for delta
-            MarketData bumped = mkt;
-            bumped.spot = mkt.spot * 1.01;
-            double pv_up = price_trade(trade, bumped);
-            double delta_dollar = (pv_up - pv) / 0.01;  // dollar delta
+        for (std::size_t i = 0; i < positions_.size(); ++i) {
+            double pv = pvs[i];
+            total_pv += pv;
+            double delta_dollar = (pvs_up[i] - pv) / 0.01;  // dollar delta
 
             total_delta_dollar += delta_dollar;
-            risks.push_back({name, pv, std::fabs(delta_dollar)});
+            risks.push_back({positions_[i].first, pv, std::fabs(delta_dollar)});
         }
 
         // Delta-normal VaR: VaR = z * σ * √h * |ΔS portfolio|
@@ -476,6 +4922,18 @@ public:
         return { total_pv, var95, var99, comp_var95, worst->name };
     }
 
+    FactorVaRResult compute_factor(const MarketData& mkt, const FactorCovariance& fc,
+                                   double horizon_days = 10, const PricingConfig& pc = {}) const {
+        return factor_var(positions_, mkt, fc, horizon_days, pc);
+    }
+
+    KeyRateResult key_rate_ladder(const MarketData& mkt, const PricingConfig& pc = {}) const {
+        std::vector<Trade> trades;
+        trades.reserve(positions_.size());
+        for (auto& pos : positions_) trades.push_back(pos.second);
+        return key_rate_dv01(trades, mkt, pc);
+    }
+
 private:
     std::vector<std::pair<std::string, Trade>> positions_;
 };
@@ -501,7 +4959,7 @@ CVAResult compute_cva(const Trade& trade, const MarketData& mkt,
         double ti = i * dt_grid;
         // Expected exposure via shifted spot simulation (rough approx)
         // Here we just decay PV * survival — production would use full MC
-        double pv_i = price_trade(trade, mkt) * std::exp(-mkt.rate * (T - ti));
+        double pv_i = price_trade(trade, mkt) * std::exp(-mkt.rate_to(T) * (T - ti));
         double ee   = std::max(pv_i, 0.0);
         double surv = std::exp(-hazard * ti);
         double pd   = std::exp(-hazard * (ti - dt_grid)) - surv;
@@ -525,19 +4983,90 @@ void print_header(const std::string& title) {
     print_separator();
 }
 
+// ============================================================================
+// §9a  Sharded Monte Carlo driver
+// ============================================================================
+// A fixed reference job (1Y ATM call, 252 steps, 2^22 antithetic pairs) that
+// can be split across processes or machines:
+//   quant_engine shard <i> <n> <file>   simulate shard i of n, write partial
+//   quant_engine merge <file>...        merge partials and print the estimate
+// Shard boundaries fall on MCPartial::CHUNK, so the merged result equals a
+// single-process run exactly.
+namespace shard_job {
+
+constexpr uint64_t N_SAMPLES = uint64_t{1} << 22;
+
+inline MonteCarlo engine(unsigned n_threads) {
+    MCConfig cfg;
+    cfg.n_paths = N_SAMPLES;
+    cfg.n_threads = n_threads;
+    return MonteCarlo(100.0, 0.05, 0.015, 0.20, 1.0, cfg);
+}
+
+inline double payoff(const std::vector<double>& path) {
+    return std::max(path.back() - 100.0, 0.0);
+}
+
+inline std::pair<uint64_t, uint64_t> range(uint64_t i, uint64_t n) {
+    const uint64_t chunks = (N_SAMPLES + MCPartial::CHUNK - 1) / MCPartial::CHUNK;
+    auto edge = [&](uint64_t k) { return std::min(N_SAMPLES, chunks * k / n * MCPartial::CHUNK); };
+    return {edge(i), edge(i + 1)};
+}
+
+inline int cli(int argc, char** argv) try {
+    const std::string mode = argv[1];
+    std::cout << std::fixed << std::setprecision(6);
+    if (mode == "shard" && argc == 5) {
+        const uint64_t i = std::stoull(argv[2]), n = std::stoull(argv[3]);
+        if (n == 0 || i >= n) throw std::invalid_argument("shard: need 0 <= i < n");
+        auto [lo, hi] = range(i, n);
+        auto t0 = std::chrono::steady_clock::now();
+        auto hw = std::max(1u, std::thread::hardware_concurrency());
+        engine(hw).run_shard(payoff, lo, hi, true).save(argv[4]);
+        std::cout << "shard " << i << "/" << n << ": samples [" << lo << ", " << hi << ") -> "
+                  << argv[4] << "  [" << std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - t0).count() << " ms]\n";
+        return 0;
+    }
+    if (mode == "merge" && argc >= 3) {
+        MCPartial total;
+        for (int a = 2; a < argc; ++a) total.merge(MCPartial::load(argv[a]));
+        std::cout << "merged " << argc - 2 << " partials, " << total.count() << " / " << total.total
+                  << " samples\n";
+        if (!total.complete()) {
+            std::cerr << argv[0] << ": merge: shards missing, no estimate\n";
+            return 2;
+        }
+        auto res = total.result();
+        std::cout << "  price = " << res.price << "  ± " << res.std_error << '\n'
+                  << "  delta = " << total.delta() << "  gamma = " << total.gamma() << '\n';
+        return 0;
+    }
+    std::cerr << "usage: " << argv[0] << " shard <i> <n> <file> | merge <file>...\n";
+    return 1;
+} catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << '\n'
+              << "usage: " << argv[0] << " shard <i> <n> <file> | merge <file>...\n";
+    return 1;
+}
+
+} // namespace shard_job
+
 // ============================================================================
 // §10  Main — build a sample book and run analytics
 // ============================================================================
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1) return shard_job::cli(argc, argv);
     std::cout << std::fixed << std::setprecision(4);
 
     // --- Market Data ---
     print_header("MARKET DATA");
 
     // Bootstrap yield curve from swap rates
-    auto curve = YieldCurve::from_swap_rates({
+    const std::vector<std::pair<double,double>> swaps{
         {1, 0.0525}, {2, 0.0490}, {3, 0.0470}, {5, 0.0455}, {7, 0.0448}, {10, 0.0440}
-    });
+    };
+    auto curve = YieldCurve::from_swap_rates(swaps);
     std::cout << "  Yield curve bootstrapped from 6 swap pillars\n";
     for (double t : {0.5, 1.0, 2.0, 5.0, 10.0})
         std::cout << "    z(" << t << "y) = " << curve.zero_rate(t) * 100 << "%"
@@ -552,7 +5081,36 @@ int main() {
     });
 
     double S0 = 100.0, r = 0.05, q = 0.015;
-    MarketData mkt { S0, r, q, vol_surf };
+    MarketData mkt { S0, r, q, vol_surf, std::make_shared<const YieldCurve>(curve) };
+
+    // SVI calibration: 40 expiries x 100 strikes generated from a skewed SVI
+    // surface, fitted cold and then refitted warm after a quote update
+    {
+        std::vector<VolSurface::Node> quotes;
+        for (int i = 0; i < 40; ++i) {
+            double T = 0.1 + 0.1 * i, F = S0 * std::exp((r - q) * T);
+            SVISlice gen{T, 0.03 * T, 0.1 * std::sqrt(T) + 0.02, -0.6, 0.05, 0.15};
+            for (int j = 0; j < 100; ++j) {
+                double k = -0.5 + j * 0.01;
+                quotes.push_back({T, F * std::exp(k), std::sqrt(gen.total_variance(k) / T)});
+            }
+        }
+        SVICalibrator svi(S0, r, q);
+        auto report = [](const char* label, const SVICalibration& cal) {
+            double worst = 0;
+            int iters = 0;
+            for (auto& f : cal.fits) { worst = std::max(worst, f.rmse_vol); iters += f.iterations; }
+            std::cout << "    " << label << std::setw(7) << cal.elapsed_ms << " ms  "
+                      << std::setw(4) << iters << " LM steps  max rmse = " << worst * 1e4 << " bp"
+                      << (cal.arbitrage_free() ? "  arbitrage-free\n" : "  ARBITRAGE\n");
+        };
+        std::cout << "  SVI calibration (40 expiries x 100 strikes, LM, 4 threads)\n";
+        report("cold:", svi.calibrate(quotes));
+        for (auto& quote : quotes) quote.vol += 0.002;
+        auto warm = svi.calibrate(quotes);
+        report("warm:", warm);
+        std::cout << "    1Y ATM vol = " << svi.surface(warm).implied_vol(1.0, S0) * 100 << "%\n";
+    }
 
     // --- Black-Scholes Analytics ---
     print_header("BLACK-SCHOLES ANALYTICS");
@@ -594,6 +5152,7 @@ int main() {
     MCConfig mc_cfg;
     mc_cfg.n_paths = 1'000'000;
     mc_cfg.n_threads = 4;
+    mc_cfg.pin_threads = true;
     MonteCarlo mc(S0, r, q, sigma_atm, T_opt, mc_cfg);
 
     auto euro_call_payoff = [K](const std::vector<double>& path) {
@@ -605,6 +5164,54 @@ int main() {
               << "    Std error = " << mc_res.std_error << '\n'
               << "    Time      = " << mc_res.elapsed_ms << " ms\n";
 
+    // Same product on its own schedule: one exact log-space step per path
+    const double expiry_only[] = {T_opt};
+    auto sched_res = mc.run(euro_call_payoff, expiry_only);
+    std::cout << "\n  European Call (1M paths, fixing schedule {T}, 1 step)\n"
+              << "    MC price  = " << sched_res.price << "  ± " << sched_res.std_error << '\n'
+              << "    Time      = " << sched_res.elapsed_ms << " ms  ("
+              << mc_res.elapsed_ms / sched_res.elapsed_ms << "x faster)\n";
+
+    // Same run under live telemetry, stopped once the standard error reaches 2 cents
+    struct StopAtError : MCObserver {
+        double     target;
+        std::size_t reports = 0;
+        MCProgress last{};
+        explicit StopAtError(double t) : target(t) {}
+        bool on_progress(const MCProgress& p) override {
+            ++reports;
+            last = p;
+            return p.paths_done < 10'000 || p.std_error > target;
+        }
+    } stop_at(0.02);
+    MCConfig tel_cfg = mc_cfg;
+    tel_cfg.observer = &stop_at;
+    tel_cfg.report_interval_ms = 100;
+    auto tel_res = MonteCarlo(S0, r, q, sigma_atm, T_opt, tel_cfg).run(euro_call_payoff);
+    std::cout << "\n  European Call (live telemetry, stop at SE ≤ 0.02)\n"
+              << "    MC price  = " << tel_res.price << "  ± " << tel_res.std_error
+              << (tel_res.cancelled ? "  [stopped early]" : "") << '\n'
+              << "    Paths     = " << stop_at.last.paths_done << " of " << stop_at.last.paths_total
+              << " after " << stop_at.reports << " reports ("
+              << stop_at.last.paths_per_sec / 1e6 << "M paths/s)\n";
+
+    // Cancelled on the first report, and fewer paths than threads: a run
+    // that took no samples reports price 0 ± inf rather than NaN
+    struct CancelAtOnce : MCObserver {
+        bool on_progress(const MCProgress&) override { return false; }
+    } cancel_now;
+    MCConfig cancel_cfg = mc_cfg;
+    cancel_cfg.observer = &cancel_now;
+    cancel_cfg.report_interval_ms = 1;
+    auto cancel_res = MonteCarlo(S0, r, q, sigma_atm, T_opt, cancel_cfg).run(euro_call_payoff);
+    MCConfig tiny_cfg = mc_cfg;
+    tiny_cfg.n_paths = mc_cfg.n_threads - 1;
+    auto tiny_res = MonteCarlo(S0, r, q, sigma_atm, T_opt, tiny_cfg).run(euro_call_payoff);
+    std::cout << "    Cancelled at first report: " << cancel_res.price << "  ± " << cancel_res.std_error
+              << (cancel_res.cancelled ? "  [stopped early]" : "") << '\n'
+              << "    " << tiny_cfg.n_paths << " paths on " << tiny_cfg.n_threads << " threads:     "
+              << tiny_res.price << "  ± " << tiny_res.std_error << '\n';
+
     // Asian (arithmetic average) call
     auto asian_payoff = [K](const std::vector<double>& path) {
         double avg = std::accumulate(path.begin(), path.end(), 0.0) / path.size();
@@ -615,6 +5222,224 @@ int main() {
               << "    MC price  = " << asian_res.price << '\n'
               << "    Std error = " << asian_res.std_error << '\n';
 
+    // Same Asian without simulation: the path above fixes at t = 0 and every
+    // step, so the schedule is those 253 dates
+    {
+        std::vector<double> daily(mc_cfg.n_steps + 1);
+        for (std::size_t k = 0; k < daily.size(); ++k) daily[k] = T_opt * k / mc_cfg.n_steps;
+        auto t_start = std::chrono::steady_clock::now();
+        AsianSchedule sched(daily, r, q);
+        double tw = asian_arithmetic(OptionType::Call, S0, K, T_opt, sigma_atm, sched);
+        auto t_end = std::chrono::steady_clock::now();
+        double geo = asian_geometric(OptionType::Call, S0, K, T_opt, sigma_atm, sched);
+        PricingConfig cv_pc;
+        cv_pc.asian = PricingMethod::MonteCarlo;
+        double cv = price_trade(AsianOption{OptionType::Call, K, T_opt, daily, 1.0},
+                                MarketData{S0, r, q, VolSurface(sigma_atm), nullptr}, cv_pc);
+        std::cout << "\n  Asian Call (analytic, 253 daily fixings)\n"
+                  << "    Turnbull-Wakeman = " << tw << "  ["
+                  << std::chrono::duration<double, std::micro>(t_end - t_start).count() << " us]\n"
+                  << "    Geometric        = " << geo << '\n'
+                  << "    MC + geo CV      = " << cv << "  (200k paths)\n";
+    }
+
+    // Same Asian with a streaming running-average accumulator (no stored paths)
+    auto asian_stream = mc.run_streaming(stream_payoff([K](const acc::RunningAverage& avg) {
+        return std::max(avg.mean() - K, 0.0);
+    }, acc::RunningAverage{}));
+    std::cout << "\n  Asian Call (streaming accumulator, 1M paths)\n"
+              << "    MC price  = " << asian_stream.price << '\n'
+              << "    Std error = " << asian_stream.std_error << '\n'
+              << "    Time      = " << asian_stream.elapsed_ms << " ms\n";
+
+    // Multilevel MC for the same Asian (continuous-averaging limit)
+    MLMCConfig mlmc_cfg;
+    mlmc_cfg.rmse = 0.005;
+    mlmc_cfg.n_threads = 4;
+    MultilevelMonteCarlo mlmc(S0, r, q, sigma_atm, T_opt, mlmc_cfg);
+    auto mlmc_res = mlmc.run(asian_payoff);
+    std::cout << "\n  Asian Call (MLMC, RMSE target 0.005)\n"
+              << "    MC price  = " << mlmc_res.price << '\n'
+              << "    Std error = " << mlmc_res.std_error << '\n'
+              << "    Levels    = " << mlmc_res.paths_per_level.size()
+              << "  (finest " << mlmc_res.finest_steps << " steps)\n"
+              << "    Cost      = " << mlmc_res.total_steps / 1e6 << "M steps\n"
+              << "    Time      = " << mlmc_res.elapsed_ms << " ms\n";
+
+    // Float paths vs double paths on identical normals
+    MCConfig prec_cfg;
+    prec_cfg.n_paths = 50'000;
+    prec_cfg.n_threads = 4;
+    auto prec = check_precision(S0, r, q, sigma_atm, T_opt, [K](const auto& path) {
+        double avg = std::accumulate(path.begin(), path.end(), 0.0) / path.size();
+        return std::max(avg - K, 0.0);
+    }, prec_cfg);
+    std::cout << "\n  Precision check (Asian, 50k paths)\n"
+              << "    float = " << prec.single.price << "  double = " << prec.full.price
+              << "  |Δ|/SE = " << prec.error_ratio << (prec.passed ? "  [float OK]" : "  [keep double]")
+              << '\n';
+
+    // Down-and-out put under flat vs Dupire local vol (same random numbers)
+    MCConfig lv_cfg;
+    lv_cfg.n_paths = 100'000;
+    lv_cfg.n_threads = 4;
+    auto local_vol = std::make_shared<const LocalVolSurface>(vol_surf, S0, r, q, T_opt);
+    MonteCarlo mc_flat(S0, r, q, vol_surf.implied_vol(T_opt, 100), T_opt, lv_cfg);
+    MonteCarlo mc_lv(S0, r, q, local_vol, T_opt, lv_cfg);
+    auto ko_put_payoff = [](const std::vector<double>& path) {
+        for (double s : path) if (s <= 90.0) return 0.0;
+        return std::max(100.0 - path.back(), 0.0);
+    };
+    auto ko_flat = mc_flat.run(ko_put_payoff);
+    auto ko_lv   = mc_lv.run(ko_put_payoff);
+    std::cout << "\n  Down-and-Out Put 100/90 (100k paths)\n"
+              << "    Flat vol  = " << ko_flat.price << "  ± " << ko_flat.std_error << '\n'
+              << "    Local vol = " << ko_lv.price << "  ± " << ko_lv.std_error
+              << "  [σ_loc(0.5y, 90) = " << local_vol->local_vol(0.5, 90.0) * 100 << "%]\n";
+
+    // Importance sampling for rare payoffs: drift-shift onto the most likely path
+    auto is_compare = [&](const char* label, const auto& kernel) {
+        MCConfig is_cfg = lv_cfg;
+        auto plain = MonteCarlo(S0, r, q, sigma_atm, T_opt, is_cfg).run_streaming(kernel);
+        is_cfg.drift_shift = MonteCarlo(S0, r, q, sigma_atm, T_opt, is_cfg).optimal_drift_shift(kernel);
+        auto shifted = MonteCarlo(S0, r, q, sigma_atm, T_opt, is_cfg).run_streaming(kernel);
+        std::cout << "    " << label << "  plain = " << plain.price << " ± " << plain.std_error
+                  << "   IS = " << shifted.price << " ± " << shifted.std_error
+                  << "  (μ/step = " << is_cfg.drift_shift << ")\n";
+    };
+    std::cout << "\n  Importance sampling (100k paths)\n";
+    is_compare("Call K=160     ", stream_payoff([](const acc::Terminal& t) {
+        return std::max(t.spot - 160.0, 0.0);
+    }, acc::Terminal{}));
+    is_compare("D&I Put 100/70 ", BarrierKernel<OptionType::Put, false, true>{100.0, 70.0});
+
+    // Heston: QE Monte Carlo on coarse monthly steps vs Fourier pricer
+    HestonParams heston{0.04, 1.5, 0.05, 0.5, -0.7};
+    HestonAnalytic heston_fourier(S0, r, q, heston);
+    MCConfig heston_cfg;
+    heston_cfg.n_paths = 200'000;
+    heston_cfg.n_steps = 12;
+    heston_cfg.n_threads = 4;
+    HestonMonteCarlo heston_mc(S0, r, q, heston, T_opt, heston_cfg);
+    auto heston_res = heston_mc.run(euro_call_payoff);
+    heston_cfg.n_paths = 50'000;
+    heston_cfg.n_steps = 252;
+    auto heston_ko = HestonMonteCarlo(S0, r, q, heston, T_opt, heston_cfg).run(ko_put_payoff);
+    std::cout << "\n  Heston (v0=4%, κ=1.5, θ=5%, ξ=0.5, ρ=-0.7)\n"
+              << "    Call QE MC = " << heston_res.price << "  ± " << heston_res.std_error
+              << "  (Fourier = " << heston_fourier.price(OptionType::Call, K, T_opt) << ")"
+              << "  [" << heston_res.elapsed_ms << " ms]\n"
+              << "    D&O Put    = " << heston_ko.price << "  ± " << heston_ko.std_error << '\n';
+
+    // Sharded run: four shards through partial files, merged, vs one shard
+    // covering the whole range on a different thread count
+    {
+        constexpr uint64_t n_samples = 1u << 18;
+        MCConfig shard_cfg;
+        shard_cfg.n_paths = n_samples;
+        shard_cfg.n_threads = 4;
+        MonteCarlo shard_mc(S0, r, q, sigma_atm, T_opt, shard_cfg);
+        MCPartial merged;
+        for (uint64_t i = 0; i < 4; ++i) {
+            const std::string file = "qe_shard_" + std::to_string(i) + ".part";
+            shard_mc.run_shard(euro_call_payoff, i * n_samples / 4, (i + 1) * n_samples / 4, true).save(file);
+            merged.merge(MCPartial::load(file));
+            std::remove(file.c_str());
+        }
+        shard_cfg.n_threads = 1;
+        auto whole = MonteCarlo(S0, r, q, sigma_atm, T_opt, shard_cfg).run_shard(euro_call_payoff, 0, n_samples, true);
+        auto m = merged.result(), w = whole.result();
+        std::cout << "\n  Sharded European Call (4 shards x 64k pairs, Philox stream)\n"
+                  << "    Merged    = " << m.price << "  ± " << m.std_error
+                  << "  Δ=" << merged.delta() << "  Γ=" << merged.gamma() << '\n'
+                  << "    Single    = " << w.price << "  ± " << w.std_error
+                  << "  (bitwise " << (m.price == w.price && m.std_error == w.std_error
+                                       && merged.delta() == whole.delta() ? "equal" : "DIFFERENT") << ")\n";
+    }
+
+    // Path cube: generated once, reopened by later runs; a spot bump priced
+    // on the same cube is a common-random-numbers delta
+    {
+        std::vector<double> cube_times;
+        for (int k = 1; k <= 12; ++k) cube_times.push_back(T_opt * k / 12);
+        MCConfig cube_cfg;
+        cube_cfg.n_paths = 200'000;
+        cube_cfg.n_threads = 4;
+        auto cube_start = std::chrono::steady_clock::now();
+        PathCube::open_or_create("qe_paths.cube", cube_times, cube_cfg.n_paths);
+        auto cube_mid = std::chrono::steady_clock::now();
+        auto cube = PathCube::open_or_create("qe_paths.cube", cube_times, cube_cfg.n_paths);
+        auto cube_end = std::chrono::steady_clock::now();
+        const double h = 0.01 * S0;
+        auto base = MonteCarlo(S0, r, q, sigma_atm, T_opt, cube_cfg).run(asian_payoff, cube);
+        auto up = MonteCarlo(S0 + h, r, q, sigma_atm, T_opt, cube_cfg).run(asian_payoff, cube);
+        auto down = MonteCarlo(S0 - h, r, q, sigma_atm, T_opt, cube_cfg).run(asian_payoff, cube);
+        std::cout << "\n  Path cube (200k paths x 12 monthly dates, float, memory-mapped)\n"
+                  << "    Generate  = " << std::chrono::duration<double, std::milli>(cube_mid - cube_start).count()
+                  << " ms, reopen = " << std::chrono::duration<double, std::milli>(cube_end - cube_mid).count()
+                  << " ms (" << cube.bytes() / 1048576.0 << " MiB, reused: " << (cube.created() ? "no" : "yes") << ")\n"
+                  << "    Asian     = " << base.price << "  ± " << base.std_error
+                  << "  [" << base.elapsed_ms << " ms]\n"
+                  << "    CRN delta = " << (up.price - down.price) / (2 * h) << '\n';
+        std::remove("qe_paths.cube");
+    }
+
+    // Bermudan put (Longstaff-Schwartz), monthly exercise
+    MCConfig lsm_cfg;
+    lsm_cfg.n_paths = 200'000;
+    lsm_cfg.n_threads = 4;
+    LongstaffSchwartz lsm(S0, r, q, sigma_atm, lsm_cfg);
+    auto berm_res = lsm.run(OptionType::Put, K, exercise_schedule(T_opt, 12));
+    std::cout << "\n  Bermudan Put (LSMC, 200k paths, 12 exercise dates)\n"
+              << "    MC price  = " << berm_res.price << "  (European BS = " << bs_put.price << ")\n"
+              << "    Std error = " << berm_res.std_error << '\n'
+              << "    Time      = " << berm_res.elapsed_ms << " ms\n";
+
+    // Basket and best-of (rainbow) calls on 50 correlated names
+    constexpr std::size_t n_names = 50;
+    std::vector<double> corr(n_names * n_names);
+    for (std::size_t i = 0; i < n_names; ++i)
+        for (std::size_t j = 0; j < n_names; ++j)
+            corr[i * n_names + j] = (i == j) ? 1.0 : 0.4;
+    MCConfig basket_cfg;
+    basket_cfg.n_paths = 50'000;
+    basket_cfg.n_steps = 12;
+    basket_cfg.n_threads = 4;
+    MultiAssetMonteCarlo basket_mc(std::vector<double>(n_names, S0), r,
+                                   std::vector<double>(n_names, q),
+                                   std::vector<double>(n_names, sigma_atm),
+                                   corr, T_opt, basket_cfg);
+    auto basket_res = basket_mc.run([K](const MultiPathView& p) {
+        double avg = 0;
+        for (std::size_t i = 0; i < p.n_assets(); ++i) avg += p.terminal(i);
+        return std::max(avg / p.n_assets() - K, 0.0);
+    });
+    auto rainbow_res = basket_mc.run([K](const MultiPathView& p) {
+        double best = 0;
+        for (std::size_t i = 0; i < p.n_assets(); ++i) best = std::max(best, p.terminal(i));
+        return std::max(best - K, 0.0);
+    });
+    std::cout << "\n  50-name Basket / Best-of Call (ρ=0.4, 50k paths, 12 steps)\n"
+              << "    Basket    = " << basket_res.price << "  ± " << basket_res.std_error
+              << "  [" << basket_res.elapsed_ms << " ms]\n"
+              << "    Best-of   = " << rainbow_res.price << "  ± " << rainbow_res.std_error
+              << "  [" << rainbow_res.elapsed_ms << " ms]\n";
+
+    // --- Finite-Difference Engine ---
+    print_header("FINITE-DIFFERENCE ENGINE (CRANK-NICOLSON)");
+    FiniteDifference fd(S0, r, q, sigma_atm);
+    auto fd_call = fd.vanilla(OptionType::Call, K, T_opt);
+    std::cout << "  European Call   PDE = " << fd_call.price << "  (BS = " << bs_call.price << ")"
+              << "  Δ=" << fd_call.delta << "  Γ=" << fd_call.gamma
+              << "  Θ=" << fd_call.theta << "  [" << fd_call.elapsed_ms << " ms]\n";
+    auto fd_ko = fd.barrier(OptionType::Put, 100, T_opt, 90, false, false);
+    std::cout << "  KO Put 100/90   PDE = " << fd_ko.price
+              << "  Δ=" << fd_ko.delta << "  Γ=" << fd_ko.gamma
+              << "  Θ=" << fd_ko.theta << "  [" << fd_ko.elapsed_ms << " ms]\n";
+    auto fd_berm = fd.bermudan(OptionType::Put, K, T_opt, exercise_schedule(T_opt, 12));
+    std::cout << "  Bermudan Put    PDE = " << fd_berm.price << "  (LSMC = " << berm_res.price << ")"
+              << "  [" << fd_berm.elapsed_ms << " ms]\n";
+
     // --- Portfolio Risk ---
     print_header("PORTFOLIO RISK (VaR)");
 
@@ -636,6 +5461,127 @@ int main() {
               << "    Comp VaR (95%)  = " << risk_res.component_var_95
               << "  [" << risk_res.worst_name << "]\n";
 
+    // Multi-factor delta-gamma VaR: spot, every vol node and every curve pillar, with
+    // the factor covariance estimated from a (synthetic) 2-year daily history
+    auto factors = risk_factors(mkt);
+    const std::size_t n_days = 500;
+    std::vector<double> history(n_days * factors.size());
+    {
+        std::mt19937_64 rng(7);
+        std::normal_distribution<double> N(0.0, 1.0);
+        double spot_daily = vol_surf.implied_vol(0.25, S0) / std::sqrt(252.0);
+        for (std::size_t d = 0; d < n_days; ++d) {
+            double zs = N(rng), zv = N(rng), zr = N(rng);
+            for (std::size_t f = 0; f < factors.size(); ++f) {
+                double& x = history[d * factors.size() + f];
+                switch (factors[f].kind) {
+                    case FactorKind::Spot: x = spot_daily * zs; break;
+                    case FactorKind::Vol:  x = 0.004 * (-0.7 * zs + 0.6 * zv + 0.39 * N(rng)); break;
+                    case FactorKind::Rate: x = 0.0006 * zr; break;
+                    case FactorKind::Pillar: x = 0.0006 * (0.9 * zr + 0.44 * N(rng)); break;
+                }
+            }
+        }
+    }
+    auto factor_cov = FactorCovariance::from_returns(factors, history);
+    PricingConfig risk_pc;
+    risk_pc.barrier = PricingMethod::PDE;
+    auto fvar = risk.compute_factor(mkt, factor_cov, 10, risk_pc);
+    const auto n_pillars = std::count_if(factors.begin(), factors.end(),
+                                         [](auto& f) { return f.kind == FactorKind::Pillar; });
+    std::cout << "\n  Delta-gamma VaR (" << factors.size() << " factors: spot, "
+              << factors.size() - 1 - n_pillars << " vol nodes, " << n_pillars << " curve pillars)\n"
+              << "    10d VaR (95%)   = " << fvar.var_95 << '\n'
+              << "    10d VaR (99%)   = " << fvar.var_99 << '\n'
+              << "    Gamma drift     = " << fvar.expected_pnl << '\n'
+              << "    Comp VaR (95%)  = " << fvar.component_var_95
+              << "  [" << fvar.worst_name << "]\n"
+              << "    Book Δ (1% spot) = " << fvar.factor_delta[0] * 0.01
+              << "   Time = " << fvar.elapsed_ms << " ms\n";
+
+    // Barrier book: one simulation per trade vs shared paths
+    std::vector<Trade> barrier_book{
+        BarrierOption{OptionType::Put,  100, 1.0,  90, false, false, 300},
+        BarrierOption{OptionType::Put,  100, 1.0,  85, true,  false, 200},
+        BarrierOption{OptionType::Call, 100, 0.5, 120, false, true,  400},
+        BarrierOption{OptionType::Call, 105, 1.0, 125, true,  true,  250},
+    };
+    auto book_t0 = std::chrono::high_resolution_clock::now();
+    std::vector<double> book_single;
+    for (auto& t : barrier_book) book_single.push_back(price_trade(t, mkt));
+    auto book_t1 = std::chrono::high_resolution_clock::now();
+    auto book_shared = price_book(barrier_book, mkt);
+    auto book_t2 = std::chrono::high_resolution_clock::now();
+    std::cout << "\n  Barrier book (4 trades, 200k paths)\n";
+    for (std::size_t i = 0; i < barrier_book.size(); ++i)
+        std::cout << "    Trade " << i << ": per-trade = " << std::setw(10) << book_single[i]
+                  << "   shared = " << std::setw(10) << book_shared[i] << '\n';
+    std::cout << "    Time: per-trade = "
+              << std::chrono::duration<double, std::milli>(book_t1 - book_t0).count()
+              << " ms   shared paths = "
+              << std::chrono::duration<double, std::milli>(book_t2 - book_t1).count() << " ms\n";
+
+    // --- Chebyshev proxies ---
+    print_header("CHEBYSHEV PRICING PROXIES");
+    {
+        // 100k scenarios: spot ±25%, vol x0.6-1.6, rate ±150bp
+        constexpr std::size_t n_scen = 100'000;
+        std::mt19937_64 rng(2024);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<std::array<double, 3>> scen(n_scen);
+        for (auto& sc : scen)
+            sc = {S0 * (0.75 + 0.5 * u(rng)), 0.6 + u(rng), -0.015 + 0.03 * u(rng)};
+
+        PricingConfig proxy_pc;
+        proxy_pc.barrier = PricingMethod::PDE;
+        auto domain = ProxyDomain::around(mkt);
+        auto proxy_row = [&](const char* label, const Trade& trade) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            TradeProxy proxy(trade, mkt, domain, proxy_pc);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            const double T = std::visit([](auto& t) { return t.expiry; }, trade);
+            const double K = std::visit([](auto& t) { return t.strike; }, trade);
+            // Scenario markets (spot, σ, r) and the same in proxy variables,
+            // generated outside the timed loops
+            std::vector<std::array<double, 3>> markets(n_scen), vars(n_scen);
+            for (std::size_t i = 0; i < n_scen; ++i) {
+                markets[i] = {scen[i][0], scen[i][1] * vol_surf.implied_vol(T, K), mkt.rate_to(T) + scen[i][2]};
+                vars[i] = {std::log(markets[i][0] / K), markets[i][1] * std::sqrt(T), markets[i][2]};
+            }
+            auto t2 = std::chrono::high_resolution_clock::now();
+            double sum = 0;
+            for (auto& [x, v, r] : vars) sum += proxy.price_at(x, v, r);
+            auto t3 = std::chrono::high_resolution_clock::now();
+            // Exact repricing on a subset, for error and cost comparison
+            constexpr std::size_t n_check = 200;
+            std::vector<double> exact(n_check);
+            for (std::size_t i = 0; i < n_check; ++i) {
+                auto [spot, sigma, rate] = markets[i];
+                exact[i] = price_trade(trade, MarketData{spot, rate, q, VolSurface(sigma), nullptr}, proxy_pc);
+            }
+            auto t4 = std::chrono::high_resolution_clock::now();
+            double worst = 0;
+            for (std::size_t i = 0; i < n_check; ++i) {
+                auto [spot, sigma, rate] = markets[i];
+                worst = std::max(worst, std::fabs(proxy.price(spot, sigma, rate) - exact[i]));
+            }
+            std::cout << "  " << label << "  build " << std::setw(7)
+                      << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms  "
+                      << proxy.bytes() / 1024.0 << " KiB  bound " << proxy.error_bound()
+                      << "  max err " << worst << '\n'
+                      << "    proxy " << std::setw(9)
+                      << std::chrono::duration<double, std::nano>(t3 - t2).count() / n_scen
+                      << " ns/reval   exact " << std::setw(11)
+                      << std::chrono::duration<double, std::nano>(t4 - t3).count() / n_check
+                      << " ns/reval   mean PV " << sum / n_scen << '\n';
+        };
+        // The vanilla is analytic, so its proxy only matches the closed form's
+        // cost; the PDE-priced barrier is where a proxy pays off
+        std::cout << "  100k scenarios (spot ±25%, vol x0.6-1.6, rate ±150bp), unit notional\n";
+        proxy_row("Call 105 1Y      ", VanillaOption{OptionType::Call, 105, 1.0, 1.0});
+        proxy_row("D&O Put 100/85 1Y", BarrierOption{OptionType::Put, 100, 1.0, 85, false, false, 1.0});
+    }
+
     // --- CVA ---
     print_header("CVA — COUNTERPARTY CREDIT RISK");
     auto cva_res = compute_cva(
@@ -650,14 +5596,125 @@ int main() {
     // --- Curve Sensitivity (DV01) ---
     print_header("INTEREST RATE SENSITIVITY (DV01)");
     VanillaOption rate_trade{OptionType::Call, 100, 5.0, 100'000};
+    risk.add_position("5Y ATM Call", rate_trade);
     double base_pv = price_trade(rate_trade, mkt);
+    auto ladder = risk.key_rate_ladder(mkt);
+
+    // Full parallel shift (every swap +1bp, rebootstrapped) for comparison
+    auto swaps_up = swaps;
+    for (auto& sw : swaps_up) sw.second += 0.0001;
     MarketData mkt_up = mkt;
-    mkt_up.rate += 0.0001;  // +1bp
+    mkt_up.curve = std::make_shared<const YieldCurve>(YieldCurve::from_swap_rates(swaps_up));
     double pv_up = price_trade(rate_trade, mkt_up);
     double dv01 = pv_up - base_pv;
     std::cout << "  5Y ATM Call, notional 100,000\n"
               << "    Base PV = " << base_pv << '\n'
-              << "    DV01    = " << dv01 << " (per bp parallel shift)\n";
+              << "    DV01    = " << dv01 << " (per bp parallel shift)\n"
+              << "\n  Key-rate DV01 ladder (5 positions, +1bp per swap pillar)\n";
+    for (std::size_t k = 0; k < ladder.maturities.size(); ++k)
+        std::cout << "    " << std::setw(4) << static_cast<int>(ladder.maturities[k]) << "Y   DV01 = "
+                  << std::setw(10) << ladder.dv01[k] << "   repriced " << ladder.repriced[k] << " trade(s)\n";
+    std::cout << "    Total = " << ladder.total_dv01 << "   [" << ladder.elapsed_ms << " ms]\n";
+
+    // --- Live ticks ---
+    print_header("LIVE MARKET DATA (LOCK-FREE TICK QUEUE)");
+    LivePricer live({mkt, MarketData{50.0, 0.04, 0.0, VolSurface(0.30), nullptr}});
+    {
+        std::mt19937_64 rng(11);
+        std::uniform_real_distribution<double> U(0.0, 1.0);
+        for (int i = 0; i < 3000; ++i) {
+            uint32_t inst = i % 2;
+            double spot = inst ? 50.0 : S0;
+            live.add_position(inst, VanillaOption{U(rng) < 0.5 ? OptionType::Call : OptionType::Put,
+                                                  spot * (0.8 + 0.4 * U(rng)), 0.1 + 1.9 * U(rng), 10});
+        }
+        for (int i = 0; i < 4; ++i)
+            live.add_position(1, BarrierOption{OptionType::Put, 50, 1.0, 40.0 + i, false, false, 100});
+    }
+    live.start();
+    double live_pv0 = live.total_pv();
+    std::thread feed([&live] {
+        std::mt19937_64 rng(5);
+        std::normal_distribution<double> N(0.0, 1.0);
+        double s0 = 100.0, s1 = 50.0;
+        for (int burst = 0; burst < 300; ++burst) {
+            for (int k = 0; k < 8; ++k) {
+                s0 *= 1.0 + 0.0005 * N(rng);
+                s1 *= 1.0 + 0.0005 * N(rng);
+                while (!live.push({MarketTick::Field::Spot, 0, 0, s0})) {}
+                while (!live.push({MarketTick::Field::Spot, 1, 0, s1})) {}
+            }
+            if (burst % 50 == 0) live.push({MarketTick::Field::Vol, 0, 4, 0.21});
+            if (burst % 100 == 0) live.push({MarketTick::Field::Rate, 1, 0, 0.0001});
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    feed.join();
+    live.stop();
+    auto lat = live.latency();
+    std::cout << "  3004 positions on 2 instruments, " << lat.ticks << " ticks in "
+              << lat.batches << " coalesced batches\n"
+              << "    Book PV      = " << live_pv0 << " -> " << live.total_pv() << '\n'
+              << "    Tick-to-PV   = p50 " << lat.p50_us << " µs   p99 " << lat.p99_us
+              << " µs   max " << lat.max_us << " µs\n";
+    {
+        // A tick for a vol node the surface lacks is dropped, and a trade that
+        // cannot be priced counts failures; neither stops the pricing thread
+        LivePricer guard({mkt});
+        guard.add_position(0, VanillaOption{OptionType::Call, 100, 1.0, 1});
+        guard.add_position(0, AsianOption{OptionType::Call, 100, 1.0, {}, 1});
+        guard.start();
+        guard.push({MarketTick::Field::Vol, 0, 1000, 0.25});
+        guard.push({MarketTick::Field::Spot, 0, 0, 101.0});
+        guard.stop();
+        std::cout << "    Bad input    = " << guard.dropped_ticks() << " tick(s) dropped, "
+                  << guard.failures(1) << " failed repricing(s), call PV " << guard.pv(0) << '\n';
+    }
+
+    // --- Snapshot hot swap ---
+    print_header("MARKET SNAPSHOTS (EPOCH-BASED HOT SWAP)");
+    {
+        // Spot is tied to the version, so a reader can check it never sees
+        // a market from one update mixed with a version from another
+        MarketStore store(mkt);
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> valuations{0}, inconsistent{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t)
+            readers.emplace_back([&] {
+                uint64_t n = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto snap = store.read();
+                    if (std::fabs(snap->spot - (S0 + 0.01 * snap.version())) > 1e-9) ++inconsistent;
+                    double pv = price_trade(rate_trade, *snap);
+                    if (!std::isfinite(pv)) ++inconsistent;
+                    ++n;
+                }
+                valuations += n;
+            });
+        auto swaps_live = swaps;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        constexpr uint64_t n_updates = 2000;
+        for (uint64_t v = 1; v <= n_updates; ++v) {
+            store.update([&](MarketData& m) {
+                m.spot = S0 + 0.01 * v;
+                if (v % 100 == 0) {     // intraday curve rebuild
+                    for (auto& sw : swaps_live) sw.second += 0.00001;
+                    m.curve = std::make_shared<const YieldCurve>(YieldCurve::from_swap_rates(swaps_live));
+                }
+            });
+            if (v % 20 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        stop = true;
+        for (auto& th : readers) th.join();
+        std::size_t pinned = store.collect();
+        std::cout << "  3 pricing threads, " << n_updates << " published updates (20 curve rebuilds)\n"
+                  << "    Valuations   = " << valuations.load() << "   inconsistent = " << inconsistent.load() << '\n'
+                  << "    Reclaimed    = " << store.reclaimed() << "   still pinned = " << pinned << '\n'
+                  << "    Publish time = " << std::chrono::duration<double, std::micro>(t1 - t0).count() / n_updates
+                  << " µs per update (incl. pacing)\n";
+    }
 
     print_header("DONE");
     return 0;